@@ -0,0 +1,86 @@
+// compares the plain binary search over the sidbase against the eytzinger index,
+// and against the perfect hash if `dconstruct sidbase mph` was run for the sidbase.
+// works for compressed sidbases too, where every hit also decodes its string.
+// usage: sid_search_bench <sidbase.bin> [num_lookups] [hit_percent]
+
+#include "disassembly/sidbase.h"
+#include <chrono>
+#include <span>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+template<typename Func>
+static f64 time_lookups(const std::vector<sid64>& queries, Func&& lookup, u64& found) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    found = 0;
+    for (const sid64 query : queries) {
+        found += lookup(query) != nullptr;
+    }
+    const auto time_taken = std::chrono::duration<f64, std::nano>(std::chrono::high_resolution_clock::now() - start);
+    return time_taken.count() / queries.size();
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cout << "usage: sid_search_bench <sidbase.bin> [num_lookups] [hit_percent]\n";
+        return -1;
+    }
+    const u64 num_lookups = argc > 2 ? std::stoull(argv[2]) : 10'000'000;
+    const u64 hit_percent = argc > 3 ? std::stoull(argv[3]) : 50;
+
+    dconstruct::SIDBaseLayer sorted;
+    sorted.load(argv[1], false);
+    dconstruct::SIDBaseLayer eytzinger;
+    eytzinger.load(argv[1], false);
+    dconstruct::SIDBaseLayer perfect_hash;
+    perfect_hash.load(argv[1]);
+    const std::span<const dconstruct::SIDBaseEntry> entries = sorted.entries();
+    const u64 num_entries = entries.size();
+
+    // hits are hashes from the sidbase, misses are random values, like the plain numbers the disassembler checks
+    std::mt19937_64 rng(1234);
+    std::vector<sid64> queries(num_lookups);
+    for (sid64& query : queries) {
+        query = rng() % 100 < hit_percent ? entries[rng() % num_entries].hash : rng();
+    }
+
+    const auto build_start = std::chrono::high_resolution_clock::now();
+    eytzinger.build_search_index();
+    const auto build_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - build_start);
+
+    for (const sid64 query : queries) {
+        const char* expected = sorted.search(query);
+        const char* actual = eytzinger.search(query);
+        if ((expected == nullptr) != (actual == nullptr) || (expected != nullptr && sorted.offset_of(expected) != eytzinger.offset_of(actual))) {
+            std::cout << "mismatch for " << std::hex << query << '\n';
+            return -1;
+        }
+        if (perfect_hash.has_perfect_hash()) {
+            const char* hashed = perfect_hash.search(query);
+            if ((expected == nullptr) != (hashed == nullptr) || (expected != nullptr && sorted.offset_of(expected) != perfect_hash.offset_of(hashed))) {
+                std::cout << "perfect hash mismatch for " << std::hex << query << '\n';
+                return -1;
+            }
+        }
+    }
+
+    u64 found_sorted = 0;
+    u64 found_eytzinger = 0;
+    const f64 sorted_ns = time_lookups(queries, [&](const sid64 sid) { return sorted.search(sid); }, found_sorted);
+    const f64 eytzinger_ns = time_lookups(queries, [&](const sid64 sid) { return eytzinger.search(sid); }, found_eytzinger);
+
+    std::cout << num_entries << " entries, " << num_lookups << " lookups, " << found_sorted << " found\n";
+    std::cout << "binary search:    " << sorted_ns << " ns/lookup\n";
+    std::cout << "eytzinger search: " << eytzinger_ns << " ns/lookup (index built in " << build_time.count() << "ms)\n";
+    if (perfect_hash.has_perfect_hash()) {
+        u64 found_perfect_hash = 0;
+        const f64 perfect_hash_ns = time_lookups(queries, [&](const sid64 sid) { return perfect_hash.search(sid); }, found_perfect_hash);
+        std::cout << "perfect hash:     " << perfect_hash_ns << " ns/lookup\n";
+        if (found_perfect_hash != found_sorted) {
+            return -1;
+        }
+    }
+    return found_sorted == found_eytzinger ? 0 : -1;
+}
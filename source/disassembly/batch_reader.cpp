@@ -0,0 +1,333 @@
+#include "batch_reader.h"
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define DCONSTRUCT_IO_URING 1
+#include <linux/io_uring.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace dconstruct {
+    BatchReader::BatchReader(std::span<const std::filesystem::path> paths, const u32 queue_depth, const u32 max_ready)
+        : m_paths(paths), m_queueDepth(queue_depth), m_maxReady(max_ready) {
+        m_thread = std::thread(&BatchReader::run, this);
+    }
+
+    BatchReader::~BatchReader() {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stop = true;
+        }
+        m_roomCondition.notify_all();
+        m_thread.join();
+    }
+
+    [[nodiscard]] b8 BatchReader::next(LoadedFile& file) {
+        std::unique_lock lock(m_mutex);
+        if (m_handedOut == m_paths.size()) {
+            return false;
+        }
+        m_readyCondition.wait(lock, [this] { return !m_ready.empty(); });
+        file = std::move(m_ready.front());
+        m_ready.pop_front();
+        ++m_handedOut;
+        lock.unlock();
+        m_roomCondition.notify_one();
+        return true;
+    }
+
+    [[nodiscard]] b8 BatchReader::wait_for_room() {
+        std::unique_lock lock(m_mutex);
+        m_roomCondition.wait(lock, [this] { return m_stop || m_ready.size() < m_maxReady; });
+        return !m_stop;
+    }
+
+    void BatchReader::push(LoadedFile&& file) {
+        {
+            std::lock_guard lock(m_mutex);
+            m_ready.push_back(std::move(file));
+        }
+        m_readyCondition.notify_one();
+    }
+
+    void BatchReader::run() {
+        if (!read_with_io_uring()) {
+            read_blocking();
+        }
+    }
+
+    void BatchReader::read_blocking() {
+        for (u64 i = 0; i < m_paths.size(); ++i) {
+            if (!wait_for_room()) {
+                return;
+            }
+            LoadedFile file{ i };
+            std::ifstream stream(m_paths[i], std::ios::binary);
+            std::error_code ec;
+            const u64 size = std::filesystem::file_size(m_paths[i], ec);
+            if (stream.is_open() && !ec) {
+                file.m_bytes = BufferPool::local()->take(size);
+                file.m_size = size;
+                file.m_ok = static_cast<b8>(stream.read(reinterpret_cast<char*>(file.m_bytes.get()), size));
+            }
+            push(std::move(file));
+        }
+    }
+
+#ifdef DCONSTRUCT_IO_URING
+    // just enough of an io_uring wrapper for a single thread submitting reads, so we don't depend on liburing
+    class Ring {
+    public:
+        Ring() = default;
+        Ring(const Ring&) = delete;
+        Ring& operator=(const Ring&) = delete;
+
+        ~Ring() {
+            if (m_sqes != nullptr) {
+                munmap(m_sqes, m_sqesSize);
+            }
+            if (m_cqRing != nullptr && m_cqRing != m_sqRing) {
+                munmap(m_cqRing, m_cqRingSize);
+            }
+            if (m_sqRing != nullptr) {
+                munmap(m_sqRing, m_sqRingSize);
+            }
+            if (m_fd >= 0) {
+                ::close(m_fd);
+            }
+        }
+
+        [[nodiscard]] b8 setup(const u32 entries) noexcept {
+            io_uring_params params{};
+            m_fd = static_cast<i32>(syscall(__NR_io_uring_setup, entries, &params));
+            if (m_fd < 0) {
+                return false;
+            }
+
+            m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(u32);
+            m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            const b8 single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if (single_mmap) {
+                m_sqRingSize = m_cqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+            }
+
+            m_sqRing = map(m_sqRingSize, IORING_OFF_SQ_RING);
+            if (m_sqRing == nullptr) {
+                return false;
+            }
+            m_cqRing = single_mmap ? m_sqRing : map(m_cqRingSize, IORING_OFF_CQ_RING);
+            if (m_cqRing == nullptr) {
+                return false;
+            }
+            m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+            m_sqes = reinterpret_cast<io_uring_sqe*>(map(m_sqesSize, IORING_OFF_SQES));
+            if (m_sqes == nullptr) {
+                return false;
+            }
+
+            m_sqTail = field(m_sqRing, params.sq_off.tail);
+            m_sqMask = *field(m_sqRing, params.sq_off.ring_mask);
+            m_sqArray = field(m_sqRing, params.sq_off.array);
+            m_cqHead = field(m_cqRing, params.cq_off.head);
+            m_cqTail = field(m_cqRing, params.cq_off.tail);
+            m_cqMask = *field(m_cqRing, params.cq_off.ring_mask);
+            m_cqes = reinterpret_cast<io_uring_cqe*>(reinterpret_cast<std::byte*>(m_cqRing) + params.cq_off.cqes);
+            return true;
+        }
+
+        // queues a readv, the iovec has to stay alive until its completion is reaped
+        void queue_readv(const i32 fd, const iovec* iov, const u64 offset, const u64 user_data) noexcept {
+            const u32 tail = *m_sqTail;
+            const u32 index = tail & m_sqMask;
+            io_uring_sqe& sqe = m_sqes[index];
+            sqe = {};
+            sqe.opcode = IORING_OP_READV;
+            sqe.fd = fd;
+            sqe.addr = reinterpret_cast<u64>(iov);
+            sqe.len = 1;
+            sqe.off = offset;
+            sqe.user_data = user_data;
+            m_sqArray[index] = index;
+            __atomic_store_n(m_sqTail, tail + 1, __ATOMIC_RELEASE);
+            ++m_unsubmitted;
+        }
+
+        // submits everything queued and waits for at least one completion if wait is set
+        [[nodiscard]] b8 submit(const b8 wait) noexcept {
+            const u32 flags = wait ? IORING_ENTER_GETEVENTS : 0;
+            while (true) {
+                const i64 submitted = syscall(__NR_io_uring_enter, m_fd, m_unsubmitted, wait ? 1 : 0, flags, nullptr, 0);
+                if (submitted >= 0) {
+                    m_unsubmitted -= static_cast<u32>(submitted);
+                    return true;
+                }
+                if (errno != EINTR) {
+                    return false;
+                }
+            }
+        }
+
+        template<typename Func>
+        void for_each_completion(Func&& func) noexcept {
+            u32 head = *m_cqHead;
+            const u32 tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+            for (; head != tail; ++head) {
+                const io_uring_cqe& cqe = m_cqes[head & m_cqMask];
+                func(cqe.user_data, cqe.res);
+            }
+            __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+        }
+
+    private:
+        i32 m_fd = -1;
+        void* m_sqRing = nullptr;
+        void* m_cqRing = nullptr;
+        io_uring_sqe* m_sqes = nullptr;
+        u64 m_sqRingSize = 0;
+        u64 m_cqRingSize = 0;
+        u64 m_sqesSize = 0;
+        u32* m_sqTail = nullptr;
+        u32* m_sqArray = nullptr;
+        u32 m_sqMask = 0;
+        u32* m_cqHead = nullptr;
+        u32* m_cqTail = nullptr;
+        u32 m_cqMask = 0;
+        io_uring_cqe* m_cqes = nullptr;
+        u32 m_unsubmitted = 0;
+
+        [[nodiscard]] void* map(const u64 size, const u64 offset) const noexcept {
+            void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, offset);
+            return ptr == MAP_FAILED ? nullptr : ptr;
+        }
+
+        [[nodiscard]] static u32* field(void* ring, const u32 offset) noexcept {
+            return reinterpret_cast<u32*>(reinterpret_cast<std::byte*>(ring) + offset);
+        }
+    };
+
+    struct ReadSlot {
+        LoadedFile m_file;
+        i32 m_fd = -1;
+        u64 m_done = 0;
+        iovec m_iov{};
+    };
+
+    [[nodiscard]] b8 BatchReader::read_with_io_uring() {
+        Ring ring;
+        if (!ring.setup(m_queueDepth)) {
+            return false;
+        }
+
+        std::vector<ReadSlot> slots(m_queueDepth);
+        std::vector<u32> free_slots;
+        for (u32 i = m_queueDepth; i > 0; --i) {
+            free_slots.push_back(i - 1);
+        }
+
+        const auto queue_rest = [&ring](ReadSlot& slot, const u32 slot_index) {
+            slot.m_iov.iov_base = slot.m_file.m_bytes.get() + slot.m_done;
+            slot.m_iov.iov_len = slot.m_file.m_size - slot.m_done;
+            ring.queue_readv(slot.m_fd, &slot.m_iov, slot.m_done, slot_index);
+        };
+
+        const auto finish = [&](const u32 slot_index, const b8 ok) {
+            ReadSlot& slot = slots[slot_index];
+            ::close(slot.m_fd);
+            slot.m_fd = -1;
+            slot.m_file.m_ok = ok;
+            push(std::move(slot.m_file));
+            free_slots.push_back(slot_index);
+        };
+
+        u64 next_file = 0;
+        u32 in_flight = 0;
+        while (next_file < m_paths.size() || in_flight > 0) {
+            while (next_file < m_paths.size() && !free_slots.empty()) {
+                if (!wait_for_room()) {
+                    // nobody is going to take the remaining files, so only drain what's already in flight
+                    next_file = m_paths.size();
+                    break;
+                }
+
+                LoadedFile file{ next_file };
+                const i32 fd = ::open(m_paths[next_file].c_str(), O_RDONLY | O_CLOEXEC);
+                ++next_file;
+                struct stat st{};
+                if (fd < 0 || fstat(fd, &st) != 0) {
+                    if (fd >= 0) {
+                        ::close(fd);
+                    }
+                    push(std::move(file));
+                    continue;
+                }
+                file.m_size = st.st_size;
+                file.m_bytes = BufferPool::local()->take(file.m_size);
+                if (file.m_size == 0) {
+                    ::close(fd);
+                    file.m_ok = true;
+                    push(std::move(file));
+                    continue;
+                }
+
+                const u32 slot_index = free_slots.back();
+                free_slots.pop_back();
+                ReadSlot& slot = slots[slot_index];
+                slot.m_file = std::move(file);
+                slot.m_fd = fd;
+                slot.m_done = 0;
+                queue_rest(slot, slot_index);
+                ++in_flight;
+            }
+
+            if (in_flight == 0) {
+                continue;
+            }
+            if (!ring.submit(true)) {
+                // the ring broke down, nothing in it is going to complete anymore
+                for (u32 i = 0; i < slots.size(); ++i) {
+                    if (slots[i].m_fd >= 0) {
+                        finish(i, false);
+                    }
+                }
+                in_flight = 0;
+                continue;
+            }
+
+            ring.for_each_completion([&](const u64 user_data, const i32 result) {
+                const u32 slot_index = static_cast<u32>(user_data);
+                ReadSlot& slot = slots[slot_index];
+                if (result == -EAGAIN || result == -EINTR) {
+                    queue_rest(slot, slot_index);
+                    return;
+                }
+                if (result <= 0) {
+                    finish(slot_index, false);
+                    --in_flight;
+                    return;
+                }
+                slot.m_done += result;
+                if (slot.m_done < slot.m_file.m_size) {
+                    queue_rest(slot, slot_index);
+                    return;
+                }
+                finish(slot_index, true);
+                --in_flight;
+            });
+        }
+        return true;
+    }
+#else
+    [[nodiscard]] b8 BatchReader::read_with_io_uring() {
+        return false;
+    }
+#endif
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "base.h"
+#include "buffer_pool.h"
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+
+namespace dconstruct {
+    struct LoadedFile {
+        u64 m_index = 0;                        // index into the paths the reader was created with
+        PooledBuffer m_bytes;
+        u64 m_size = 0;
+        b8 m_ok = false;
+    };
+
+    /*
+        reads a list of files on a background thread and hands them out in the order they finish loading.
+        on linux the reads go through io_uring with up to queue_depth of them in flight at once, everywhere
+        else (or if the kernel refuses to set up a ring) the files are read one after another.
+        at most max_ready loaded files are held before the reader waits for them to be taken.
+    */
+    class BatchReader {
+    public:
+        explicit BatchReader(std::span<const std::filesystem::path> paths, const u32 queue_depth = 64, const u32 max_ready = 128);
+        BatchReader(const BatchReader&) = delete;
+        BatchReader& operator=(const BatchReader&) = delete;
+        ~BatchReader();
+
+        // blocks until the next file is loaded. returns false once every file has been handed out.
+        [[nodiscard]] b8 next(LoadedFile& file);
+
+    private:
+        std::span<const std::filesystem::path> m_paths;
+        u32 m_queueDepth;
+        u32 m_maxReady;
+
+        std::mutex m_mutex;
+        std::condition_variable m_readyCondition;
+        std::condition_variable m_roomCondition;
+        std::deque<LoadedFile> m_ready;
+        u64 m_handedOut = 0;
+        b8 m_stop = false;
+        std::thread m_thread;
+
+        void run();
+        [[nodiscard]] b8 read_with_io_uring();
+        void read_blocking();
+        [[nodiscard]] b8 wait_for_room();
+        void push(LoadedFile&& file);
+    };
+}
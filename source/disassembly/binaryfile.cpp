@@ -1,32 +1,67 @@
 #include "binaryfile.h"
+#include "relocation.h"
+#include "hash.h"
 
 #include <iostream>
 #include <fstream>
 #include <filesystem>
-#include <immintrin.h>
 #include <cstring>
 #include <chrono>
+#include <algorithm>
 
 namespace dconstruct {
     BinaryFile::BinaryFile() {}
 
-    BinaryFile::BinaryFile(const std::filesystem::path &path) {
+    BinaryFile::BinaryFile(const std::filesystem::path &path, const LoadMode mode) {
         m_path = path;
+
+        const MapAccess access = mode == LoadMode::MAPPED_READ_ONLY ? MapAccess::READ_ONLY : MapAccess::COPY_ON_WRITE;
+        if (mode != LoadMode::READ && m_mapping.open(path, access)) {
+            m_bytes = m_mapping.data();
+            m_size = m_mapping.size();
+            return;
+        }
+
+        read_file(path);
+    }
+
+    BinaryFile::BinaryFile(const std::filesystem::path &path, std::byte* bytes, const u64 size, const LoadMode mode) {
+        m_path = path;
+        m_size = size;
+
+        if (mode != LoadMode::READ) {
+            m_bytes = bytes;
+            return;
+        }
+
+        m_ownedBytes = BufferPool::local()->take(m_size);
+        std::memcpy(m_ownedBytes.get(), bytes, m_size);
+        m_bytes = m_ownedBytes.get();
+    }
+
+    BinaryFile::BinaryFile(const std::filesystem::path &path, PooledBuffer bytes, const u64 size) {
+        m_path = path;
+        m_size = size;
+        m_ownedBytes = std::move(bytes);
+        m_bytes = m_ownedBytes.get();
+    }
+
+    void BinaryFile::read_file(const std::filesystem::path &path) {
         std::ifstream scriptstream(path, std::ios::binary);
 
         if (!scriptstream.is_open()) {
-            std::cout << "error: coudln't open " << path << '\n';
+            std::cout << "error: couldn't open " << path << '\n';
             exit(-1);
         }
 
         m_size = std::filesystem::file_size(path);
-        std::byte* temp_buffer = new std::byte[m_size];
+        m_ownedBytes = BufferPool::local()->take(m_size);
 
-        scriptstream.read((char*)temp_buffer, m_size);
-        m_bytes = std::unique_ptr<std::byte[]>(temp_buffer);
+        scriptstream.read(reinterpret_cast<char*>(m_ownedBytes.get()), m_size);
+        m_bytes = m_ownedBytes.get();
     }
 
-    b8 BinaryFile::dc_setup() {
+    b8 BinaryFile::dc_setup(const DecodeMode mode) {
         constexpr u32 magic = 0x44433030;
         constexpr u32 version = 0x1;
 
@@ -35,22 +70,55 @@ namespace dconstruct {
             return false;
         }
 
-        m_dcheader = reinterpret_cast<DC_Header*>(m_bytes.get());
+        if (m_size < sizeof(DC_Header)) {
+            std::cerr << "error: not a DC-file. file is smaller than the DC header.\n";
+            return false;
+        }
+
+        m_dcheader = reinterpret_cast<DC_Header*>(m_bytes);
 
 
         if (m_dcheader->m_magic != magic) {
-            std::cerr << "error: not a DC-file. magic number doesn't equal 0x44433030: " << *(uint32_t*)m_bytes.get() << '\n';
+            std::cerr << "error: not a DC-file. magic number doesn't equal 0x44433030: " << *(uint32_t*)m_bytes << '\n';
             return false;
         }
 
         if (m_dcheader->m_versionNumber != version) {
-            std::cerr << "error: not a DC-file. version number doesn't equal 0x00000001: " << *(uint32_t*)(m_bytes.get() + 8) << '\n';
+            std::cerr << "error: not a DC-file. version number doesn't equal 0x00000001: " << *(uint32_t*)(m_bytes + 8) << '\n';
+            return false;
+        }
+
+        if (static_cast<u64>(m_dcheader->m_textSize) + 4 > m_size) {
+            std::cerr << "error: text size 0x" << std::hex << m_dcheader->m_textSize << " exceeds the filesize.\n" << std::dec;
+            return false;
+        }
+
+        const u64 table_size = *reinterpret_cast<const u32*>(m_bytes + m_dcheader->m_textSize);
+        if (static_cast<u64>(m_dcheader->m_textSize) + 4 + table_size > m_size) {
+            std::cerr << "error: relocation table size 0x" << std::hex << table_size << " exceeds the filesize.\n" << std::dec;
             return false;
         }
 
+        // the table is rounded up to whole bytes, so it may cover slots past the end. none of them may be relocated.
+        const u8* reloc_table = reinterpret_cast<const u8*>(m_bytes + m_dcheader->m_textSize + 4);
+        const u64 num_slots = m_size / 8;
+        for (u64 i = num_slots / 8; i < table_size; ++i) {
+            const u8 past_end = i == num_slots / 8 ? static_cast<u8>(0xFF << (num_slots % 8)) : 0xFF;
+            if (reloc_table[i] & past_end) {
+                std::cerr << "error: relocation table marks slots past the end of the file.\n";
+                return false;
+            }
+        }
+
+        m_decodeMode = mode;
+        m_pointerBias = mode == DecodeMode::OFFSETS ? reinterpret_cast<p64>(m_bytes) : 0;
+
         read_reloc_table();
+        build_boundary_index();
 
-        replace_newlines_in_stringtable();
+        if (mode == DecodeMode::RELOCATED) {
+            replace_newlines_in_stringtable();
+        }
 
         return true;
     }
@@ -68,12 +136,12 @@ namespace dconstruct {
 
 
     [[nodiscard]] b8 BinaryFile::gets_pointed_at(const location loc) const noexcept {
-        const p64 offset = (loc.num() - reinterpret_cast<p64>(m_bytes.get())) / 8;
+        const p64 offset = (loc.num() - reinterpret_cast<p64>(m_bytes)) / 8;
         return (u8)m_pointedAtTable[offset / 8] & (1 << (offset % 8));
     }
 
     [[nodiscard]] b8 BinaryFile::is_file_ptr(const location loc) const noexcept {
-        p64 offset = (loc.num() - reinterpret_cast<p64>(m_bytes.get()));
+        p64 offset = (loc.num() - reinterpret_cast<p64>(m_bytes));
         if (offset >= m_size) {
             return false;
         }
@@ -85,74 +153,82 @@ namespace dconstruct {
         return loc >= m_strings;
     }
 
+    void BinaryFile::build_boundary_index() {
+        const u8* table = reinterpret_cast<const u8*>(m_pointedAtTable.get());
+        const u64 num_words = (m_pointedAtSize + sizeof(u64) - 1) / sizeof(u64);
+        m_nextPointedAtWord.resize(num_words + 1);
+        m_nextPointedAtWord[num_words] = num_words;
+        for (u64 i = num_words; i-- > 0;) {
+            m_nextPointedAtWord[i] = reloc::load_word(table, m_pointedAtSize, i * 8) != 0 ? i : m_nextPointedAtWord[i + 1];
+        }
+    }
+
+    [[nodiscard]] u64 BinaryFile::next_pointed_at_slot(const u64 slot) const noexcept {
+        const u8* table = reinterpret_cast<const u8*>(m_pointedAtTable.get());
+        const u64 num_slots = m_pointedAtSize * 8;
+        if (slot >= num_slots) {
+            return slot;
+        }
+        u64 word_idx = slot / 64;
+        const u64 word = reloc::load_word(table, m_pointedAtSize, word_idx * 8) & (~u64{0} << (slot % 64));
+        if (word != 0) {
+            return word_idx * 64 + std::countr_zero(word);
+        }
+        word_idx = m_nextPointedAtWord[word_idx + 1];
+        if (word_idx * 8 >= m_pointedAtSize) {
+            return num_slots;
+        }
+        return word_idx * 64 + std::countr_zero(reloc::load_word(table, m_pointedAtSize, word_idx * 8));
+    }
+
+    [[nodiscard]] location BinaryFile::next_boundary(const location loc) const noexcept {
+        if (is_string(loc)) {
+            return loc;
+        }
+        const u64 slot = slot_of(loc);
+        const u64 pointed_at_distance = next_pointed_at_slot(slot) - slot;
+        const u64 string_distance = (m_strings.num() - loc.num() + 7) / 8;
+        return loc + std::min(pointed_at_distance, string_distance) * 8;
+    }
 
-    // void print_m512i(__m512i *var) {
-    //     alignas(64) uint64_t val[8];  // 512 bits = 8 * 64 bits
-    //     _mm512_store_epi64((__m512i*)val, *var);
-    //     for (int i = 0; i < 8; i++) {
-    //         printf("%llu  ", val[i]);
-    //     }
-    //     printf("\n");
-    // }
 
     void BinaryFile::read_reloc_table() {
 
-        std::byte *reloc_data = m_bytes.get() + m_dcheader->m_textSize;
+        std::byte *reloc_data = m_bytes + m_dcheader->m_textSize;
 
         const u32 table_size = *reinterpret_cast<u32*>(reloc_data);
-        m_pointedAtTable = std::make_unique<std::byte[]>(table_size);
+        m_pointedAtTable = BufferPool::local()->take_zeroed(table_size);
+        m_pointedAtSize = table_size;
 
         m_relocTable = location(reloc_data + 4);
 
-#ifdef DERANGED
-        const __m512i _indices = _mm512_set_epi64(7, 6, 5, 4, 3, 2, 1, 0);
-        const __m512i _1 = _mm512_set1_epi64(0x1);
-        const __m512i _7 = _mm512_set1_epi64(0x7);
-        const __m512i _3 = _mm512_set1_epi64(0x3);
-        const __m512i _base = _mm512_set1_epi64(reinterpret_cast<p64>(m_bytes.get()));
+        // OFFSETS mode only needs the pointed-at table, the image itself stays untouched
+        const p64 delta = m_decodeMode == DecodeMode::RELOCATED ? reinterpret_cast<p64>(m_bytes) : 0;
+        reloc::apply(m_bytes, m_relocTable.as<u8>(), table_size, delta, reinterpret_cast<u8*>(m_pointedAtTable.get()));
 
-        for (u64 i = 0; i < table_size; ++i) {
-            const u8* data_segment_ptr = m_bytes.get() + i * 64;
-            __m512i _data_segment = _mm512_loadu_epi64((void*)data_segment_ptr);
-            __m512i _reloc_bits = _mm512_set1_epi64(bitmap[i]);
-            _reloc_bits = _mm512_srlv_epi64(_reloc_bits, _indices);
-            __m512i _bit_mask = _mm512_and_epi64(_reloc_bits, _1);
-            __m512i _data_segment_masked = _mm512_mullo_epi64(_bit_mask, _base);
-            _data_segment_masked = _mm512_add_epi64(_data_segment_masked, _data_segment);
-            _mm512_storeu_epi64((void*)data_segment_ptr, _data_segment_masked);
-            _mm512_mask_i64scatter_epi64((void*)m_pointedAtTable.get(), (__mmask8)bitmap[i], _data_segment, _bit_mask, 0x1);
-        }
-#else
-        for (u64 i = 0; i < table_size * 8; ++i) {
-            if (m_relocTable.get<u8>(i / 8) & (1 << (i % 8))) {
-                u64* entry = reinterpret_cast<u64*>(m_bytes.get() + i * 8);
-                u64 offset = *entry;
-                *entry = reinterpret_cast<u64>(m_bytes.get() + offset);
-                reinterpret_cast<u8*>(m_pointedAtTable.get())[offset / 64] |= (1 << ((offset / 8) % 8));
-            }
-        }
-#endif
-        m_strings = location(m_bytes.get() + m_dcheader->m_stringsOffset);
+        m_strings = location(m_bytes + m_dcheader->m_stringsOffset);
     }
 
     
     [[nodiscard]] std::unique_ptr<std::byte[]> BinaryFile::get_unmapped() const noexcept { 
         std::byte *unmapped_bytes = new std::byte[m_size];
 
-        std::memcpy(unmapped_bytes, m_bytes.get(), m_size);
+        std::memcpy(unmapped_bytes, m_bytes, m_size);
+
+        if (m_decodeMode == DecodeMode::OFFSETS) {
+            return std::unique_ptr<std::byte[]>(unmapped_bytes);
+        }
 
         std::byte *reloc_data = unmapped_bytes + m_dcheader->m_textSize;
 
         const u32 table_size = *reinterpret_cast<u32*>(reloc_data);
 
-        for (u64 i = 0; i < table_size * 8; ++i) {
-            if (m_relocTable.get<u8>(i / 8) & (1 << (i % 8))) {
-                p64 *entry = reinterpret_cast<p64*>(unmapped_bytes + i * 8);
-                p64 offset = *entry;
-                *entry = offset - reinterpret_cast<p64>(m_bytes.get());
-            }
-        }
+        reloc::apply(unmapped_bytes, m_relocTable.as<u8>(), table_size, -reinterpret_cast<p64>(m_bytes), nullptr);
 
         return std::unique_ptr<std::byte[]>(unmapped_bytes);
     }
+
+    [[nodiscard]] u64 BinaryFile::content_hash() const noexcept {
+        return hash_bytes(m_bytes, m_size);
+    }
 }
@@ -7,6 +7,9 @@
 #include "DCScript.h"
 #include "sidbase.h"
 #include "instructions.h"
+#include "mapped_file.h"
+#include "struct_index.h"
+#include "buffer_pool.h"
 
 #include <memory>
 #include <string>
@@ -25,6 +28,17 @@ namespace dconstruct {
         UNKNOWN
     };
 
+    enum class LoadMode : u8 {
+        READ,       // copy the whole file into a heap buffer
+        MAPPED,     // private copy-on-write mapping, pages are only read (and copied) once they're touched
+        MAPPED_READ_ONLY, // read-only mapping, only valid together with DecodeMode::OFFSETS and no edits
+    };
+
+    enum class DecodeMode : u8 {
+        RELOCATED,  // every relocated pointer is patched into an absolute address during setup
+        OFFSETS,    // the image stays byte-identical to disk, pointers are resolved on access
+    };
+
     struct Symbol {
         SymbolType type;
         sid64 id;
@@ -43,29 +57,96 @@ namespace dconstruct {
     {
     public:
 
-        b8 dc_setup();
+        b8 dc_setup(const DecodeMode mode = DecodeMode::RELOCATED);
         BinaryFile();
 
-        BinaryFile(const std::filesystem::path &path);
+        BinaryFile(const std::filesystem::path &path, const LoadMode mode = LoadMode::MAPPED);
+
+        // a file that's part of a larger mapping, like a dcpack. the bytes are used in place and have to outlive
+        // the BinaryFile, with MAPPED they're relocated there, so the mapping has to be copy-on-write.
+        // READ works on a private copy instead.
+        BinaryFile(const std::filesystem::path &path, std::byte* bytes, const u64 size, const LoadMode mode);
+
+        // takes over a buffer the file was already read into, the image is decoded in place
+        BinaryFile(const std::filesystem::path &path, PooledBuffer bytes, const u64 size);
 
         std::filesystem::path m_path;
         DC_Header* m_dcheader = nullptr;
         StateScript* m_dcscript = nullptr;
-        std::size_t m_size;
-        std::unique_ptr<std::byte[]> m_bytes;
-        std::unique_ptr<std::byte[]> m_pointedAtTable;
+        std::size_t m_size = 0;
+        std::byte* m_bytes = nullptr;
+        PooledBuffer m_pointedAtTable;
         location m_strings;
         location m_relocTable;
         std::map<sid64, const std::string> m_sidCache;
         std::set<p64> m_emittedStructs{};
         std::vector<std::unique_ptr<FunctionDisassembly>> m_functions;
+        StructIndex m_structIndex;
+        DecodeMode m_decodeMode = DecodeMode::RELOCATED;
+
+        // turns the pointer stored in a slot of the image into an absolute address. relocated slots already hold
+        // absolute addresses in RELOCATED mode and file offsets in OFFSETS mode, every other slot is returned as is.
+        template<typename T>
+        [[nodiscard]] T* resolve(T* const& stored) const noexcept {
+            return reinterpret_cast<T*>(resolve(reinterpret_cast<const p64&>(stored)));
+        }
+
+        [[nodiscard]] p64 resolve(const p64& stored) const noexcept {
+            if (m_pointerBias == 0) {
+                return stored;
+            }
+            return is_file_ptr(location(&stored)) ? stored + m_pointerBias : stored;
+        }
+
+        // the slot decides how a value is resolved, so copies of it can't be
+        template<typename T>
+        T* resolve(T* const&&) const noexcept = delete;
+        p64 resolve(const p64&&) const noexcept = delete;
+
+        // reads the pointer stored at slot
+        [[nodiscard]] location deref(const location slot) const noexcept {
+            return location(reinterpret_cast<const void*>(resolve(slot.get<p64>())));
+        }
+
+        // the value that has to be written into the image so that it resolves to address
+        [[nodiscard]] p64 to_stored(const p64 address) const noexcept {
+            return address - m_pointerBias;
+        }
+
         [[nodiscard]] b8 is_file_ptr(const location) const noexcept;
         [[nodiscard]] b8 gets_pointed_at(const location) const noexcept;
         [[nodiscard]] b8 is_string(const location) const noexcept;
+
+        // whether address points into the image
+        [[nodiscard]] b8 contains(const p64 address) const noexcept {
+            return address - reinterpret_cast<p64>(m_bytes) < m_size;
+        }
+
+        // index of the 8-byte slot loc lies in
+        [[nodiscard]] u64 slot_of(const location loc) const noexcept {
+            return (loc.num() - reinterpret_cast<p64>(m_bytes)) / 8;
+        }
+
+        // first slot at or after slot that gets pointed at. slots past the table are returned as is.
+        [[nodiscard]] u64 next_pointed_at_slot(const u64 slot) const noexcept;
+
+        // first location loc + 8 * n (n >= 0) that either gets pointed at or lies in the string table
+        [[nodiscard]] location next_boundary(const location loc) const noexcept;
         [[nodiscard]] std::unique_ptr<std::byte[]> get_unmapped() const noexcept;
+        // hash of the image. only matches the file on disk before dc_setup relocated it.
+        [[nodiscard]] u64 content_hash() const noexcept;
 
     private:
+        p64 m_pointerBias = 0;
+        u64 m_pointedAtSize = 0;
+        // for every 64 bit word of m_pointedAtTable, the index of the first non-zero word at or after it
+        std::vector<u32> m_nextPointedAtWord;
+        PooledBuffer m_ownedBytes;
+        MappedFile m_mapping;
+
+        void read_file(const std::filesystem::path &path);
         void read_reloc_table();
+        void build_boundary_index();
         void replace_newlines_in_stringtable() noexcept;
     };
 }
@@ -0,0 +1,82 @@
+#include "buffer_pool.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace dconstruct {
+    // new buffers are rounded up, so files of similar size can share them
+    static constexpr u64 BUFFER_GRANULARITY = 0x10000;
+
+    PooledBuffer& PooledBuffer::operator=(PooledBuffer&& rhs) noexcept {
+        if (this != &rhs) {
+            release();
+            m_data = std::move(rhs.m_data);
+            m_capacity = rhs.m_capacity;
+            m_pool = std::move(rhs.m_pool);
+            rhs.m_capacity = 0;
+        }
+        return *this;
+    }
+
+    PooledBuffer::~PooledBuffer() {
+        release();
+    }
+
+    void PooledBuffer::release() noexcept {
+        if (m_data != nullptr && m_pool != nullptr) {
+            m_pool->give_back(std::move(m_data), m_capacity);
+        }
+        m_data.reset();
+        m_pool.reset();
+        m_capacity = 0;
+    }
+
+    [[nodiscard]] const std::shared_ptr<BufferPool>& BufferPool::local() {
+        thread_local const std::shared_ptr<BufferPool> pool = std::make_shared<BufferPool>();
+        return pool;
+    }
+
+    [[nodiscard]] PooledBuffer BufferPool::take(const u64 size) {
+        PooledBuffer buffer;
+        buffer.m_pool = shared_from_this();
+        {
+            std::lock_guard lock(m_mutex);
+            auto best = m_freeBuffers.end();
+            for (auto it = m_freeBuffers.begin(); it != m_freeBuffers.end(); ++it) {
+                if (it->m_capacity >= size && (best == m_freeBuffers.end() || it->m_capacity < best->m_capacity)) {
+                    best = it;
+                }
+            }
+            if (best != m_freeBuffers.end()) {
+                buffer.m_data = std::move(best->m_data);
+                buffer.m_capacity = best->m_capacity;
+                m_freeBuffers.erase(best);
+                return buffer;
+            }
+        }
+        buffer.m_capacity = std::max<u64>((size + BUFFER_GRANULARITY - 1) / BUFFER_GRANULARITY * BUFFER_GRANULARITY, BUFFER_GRANULARITY);
+        buffer.m_data = std::make_unique_for_overwrite<std::byte[]>(buffer.m_capacity);
+        return buffer;
+    }
+
+    [[nodiscard]] PooledBuffer BufferPool::take_zeroed(const u64 size) {
+        PooledBuffer buffer = take(size);
+        std::memset(buffer.get(), 0, size);
+        return buffer;
+    }
+
+    void BufferPool::give_back(std::unique_ptr<std::byte[]>&& data, const u64 capacity) noexcept {
+        std::lock_guard lock(m_mutex);
+        if (m_freeBuffers.size() < MAX_FREE_BUFFERS) {
+            m_freeBuffers.push_back(FreeBuffer{ std::move(data), capacity });
+            return;
+        }
+        // full, keep whichever buffers are the largest since they fit the most files
+        auto smallest = std::min_element(m_freeBuffers.begin(), m_freeBuffers.end(), [](const FreeBuffer& lhs, const FreeBuffer& rhs) {
+            return lhs.m_capacity < rhs.m_capacity;
+        });
+        if (smallest->m_capacity < capacity) {
+            *smallest = FreeBuffer{ std::move(data), capacity };
+        }
+    }
+}
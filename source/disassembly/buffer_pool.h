@@ -0,0 +1,77 @@
+#pragma once
+
+#include "base.h"
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace dconstruct {
+    class BufferPool;
+
+    // a heap buffer that goes back to the pool it was taken from instead of being freed.
+    // mirrors the parts of std::unique_ptr<std::byte[]> we use.
+    class PooledBuffer {
+    public:
+        PooledBuffer() = default;
+        PooledBuffer(PooledBuffer&& rhs) noexcept = default;
+        PooledBuffer& operator=(PooledBuffer&& rhs) noexcept;
+        ~PooledBuffer();
+
+        [[nodiscard]] std::byte* get() const noexcept {
+            return m_data.get();
+        }
+
+        [[nodiscard]] std::byte& operator[](const u64 index) const noexcept {
+            return m_data[index];
+        }
+
+        [[nodiscard]] explicit operator bool() const noexcept {
+            return m_data != nullptr;
+        }
+
+        [[nodiscard]] u64 capacity() const noexcept {
+            return m_capacity;
+        }
+
+    private:
+        friend class BufferPool;
+
+        std::unique_ptr<std::byte[]> m_data;
+        u64 m_capacity = 0;
+        std::shared_ptr<BufferPool> m_pool;
+
+        void release() noexcept;
+    };
+
+    /*
+        every thread keeps a few of the large per-file buffers (file images, pointed-at tables and output chunks)
+        around after a file is done, so the next file on the same thread can reuse them without going through
+        the allocator and faulting the pages in again. buffers always go back to the pool they came from, even
+        when they're freed on a different thread, and a pool never holds more than MAX_FREE_BUFFERS of each kind,
+        so the memory kept around scales with the number of threads.
+    */
+    class BufferPool : public std::enable_shared_from_this<BufferPool> {
+    public:
+        static constexpr u64 MAX_FREE_BUFFERS = 4;
+
+        // the pool of the calling thread
+        [[nodiscard]] static const std::shared_ptr<BufferPool>& local();
+
+        // a buffer of at least size bytes, the contents are uninitialized
+        [[nodiscard]] PooledBuffer take(const u64 size);
+        // a buffer of size zeroed bytes
+        [[nodiscard]] PooledBuffer take_zeroed(const u64 size);
+
+    private:
+        struct FreeBuffer {
+            std::unique_ptr<std::byte[]> m_data;
+            u64 m_capacity;
+        };
+
+        std::mutex m_mutex;
+        std::vector<FreeBuffer> m_freeBuffers;
+
+        friend class PooledBuffer;
+        void give_back(std::unique_ptr<std::byte[]>&& data, const u64 capacity) noexcept;
+    };
+}
@@ -0,0 +1,186 @@
+#include "dcpack.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace dconstruct {
+    static constexpr u32 DCPACK_MAGIC = 0x4B504344; // "DCPK"
+    static constexpr u32 DCPACK_VERSION = 1;
+
+    [[nodiscard]] static u64 align_up(const u64 value, const u64 alignment) noexcept {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    // the paths end up below the output folder, so none of them may lead out of it
+    [[nodiscard]] static b8 is_contained_path(const std::string_view path) {
+        const std::filesystem::path relative(path);
+        if (relative.empty() || relative.is_absolute() || relative.has_root_name() || relative.has_root_directory()) {
+            return false;
+        }
+        for (const std::filesystem::path& component : relative) {
+            if (component == "..") {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    [[nodiscard]] b8 DcPack::open(const std::filesystem::path& path, const MapAccess access) noexcept {
+        if (!m_mapping.open(path, access) || m_mapping.size() < sizeof(DcPackHeader)) {
+            return false;
+        }
+
+        const u64 size = m_mapping.size();
+        const DcPackHeader* header = reinterpret_cast<const DcPackHeader*>(m_mapping.data());
+        if (header->m_magic != DCPACK_MAGIC || header->m_version != DCPACK_VERSION) {
+            return false;
+        }
+        if (header->m_entriesOffset % alignof(DcPackEntry) != 0 || header->m_entriesOffset > size ||
+            header->m_numFiles > (size - header->m_entriesOffset) / sizeof(DcPackEntry)) {
+            return false;
+        }
+
+        m_entries = { reinterpret_cast<const DcPackEntry*>(m_mapping.data() + header->m_entriesOffset), header->m_numFiles };
+        u64 metadata_end = header->m_entriesOffset + header->m_numFiles * sizeof(DcPackEntry);
+        for (const DcPackEntry& entry : m_entries) {
+            if (entry.m_pathOffset > size || entry.m_pathLength > size - entry.m_pathOffset || !is_contained_path(this->path(entry))) {
+                m_entries = {};
+                return false;
+            }
+            metadata_end = std::max(metadata_end, entry.m_pathOffset + entry.m_pathLength);
+        }
+        // entries may be relocated in place, so their data can't overlap the entry table, the paths or each other
+        std::vector<u64> by_data(m_entries.size());
+        for (u64 i = 0; i < by_data.size(); ++i) {
+            by_data[i] = i;
+        }
+        std::sort(by_data.begin(), by_data.end(), [this](const u64 lhs, const u64 rhs) {
+            return m_entries[lhs].m_dataOffset < m_entries[rhs].m_dataOffset;
+        });
+        u64 data_end = metadata_end;
+        for (const u64 i : by_data) {
+            const DcPackEntry& entry = m_entries[i];
+            if (entry.m_dataOffset < data_end || entry.m_dataOffset > size || entry.m_size > size - entry.m_dataOffset || entry.m_dataOffset % 8 != 0) {
+                m_entries = {};
+                return false;
+            }
+            data_end = entry.m_dataOffset + entry.m_size;
+        }
+        m_releaseEnd.assign(m_entries.size(), size);
+        for (u64 i = 1; i < by_data.size(); ++i) {
+            m_releaseEnd[by_data[i - 1]] = m_entries[by_data[i]].m_dataOffset;
+        }
+        return true;
+    }
+
+    [[nodiscard]] b8 is_dcpack(const std::filesystem::path& path) noexcept {
+        std::ifstream file(path, std::ios::binary);
+        u32 magic = 0;
+        file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+        return file.good() && magic == DCPACK_MAGIC;
+    }
+
+    [[nodiscard]] i64 write_dcpack(const std::filesystem::path& folder, const std::filesystem::path& out) {
+        std::vector<std::filesystem::path> filepaths;
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(folder)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".bin") {
+                filepaths.emplace_back(entry.path());
+            }
+        }
+
+        std::vector<std::string> relative_paths;
+        relative_paths.reserve(filepaths.size());
+        for (const auto& path : filepaths) {
+            relative_paths.emplace_back(std::filesystem::relative(path, folder).generic_string());
+        }
+
+        std::vector<u64> order(filepaths.size());
+        for (u64 i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [&](const u64 lhs, const u64 rhs) {
+            return relative_paths[lhs] < relative_paths[rhs];
+        });
+
+        DcPackHeader header{ DCPACK_MAGIC, DCPACK_VERSION, filepaths.size(), sizeof(DcPackHeader), 0 };
+        header.m_pathsOffset = header.m_entriesOffset + filepaths.size() * sizeof(DcPackEntry);
+
+        std::vector<DcPackEntry> entries;
+        entries.reserve(filepaths.size());
+        u64 path_offset = header.m_pathsOffset;
+        for (const u64 i : order) {
+            entries.push_back(DcPackEntry{ 0, std::filesystem::file_size(filepaths[i]), path_offset, relative_paths[i].size() });
+            path_offset += relative_paths[i].size();
+        }
+        u64 data_offset = path_offset;
+        for (DcPackEntry& entry : entries) {
+            data_offset = align_up(data_offset, DCPACK_ALIGNMENT);
+            entry.m_dataOffset = data_offset;
+            data_offset += entry.m_size;
+        }
+
+        // written under a temporary name first, so nobody ever maps a half written pack
+        std::filesystem::path temp_path = out;
+        temp_path += ".tmp";
+        {
+            std::ofstream pack(temp_path, std::ios::binary | std::ios::trunc);
+            if (!pack.is_open()) {
+                std::cout << "error: couldn't open " << temp_path << " for writing\n";
+                return -1;
+            }
+            const auto discard = [&pack, &temp_path]() {
+                pack.close();
+                std::error_code ec;
+                std::filesystem::remove(temp_path, ec);
+                return -1;
+            };
+
+            pack.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            pack.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(DcPackEntry));
+            for (const u64 i : order) {
+                pack.write(relative_paths[i].data(), relative_paths[i].size());
+            }
+
+            std::vector<char> buffer;
+            for (u64 i = 0; i < entries.size(); ++i) {
+                const std::filesystem::path& path = filepaths[order[i]];
+                std::error_code ec;
+                if (std::filesystem::file_size(path, ec) != entries[i].m_size || ec) {
+                    std::cout << "error: " << path << " changed while it was packed\n";
+                    return discard();
+                }
+                std::ifstream file(path, std::ios::binary);
+                buffer.resize(entries[i].m_size);
+                if (!file.read(buffer.data(), buffer.size())) {
+                    std::cout << "error: couldn't read " << path << '\n';
+                    return discard();
+                }
+                const std::streamoff position = pack.tellp();
+                if (position < 0 || static_cast<u64>(position) > entries[i].m_dataOffset) {
+                    std::cout << "error: couldn't write " << out << '\n';
+                    return discard();
+                }
+                constexpr char zeroes[DCPACK_ALIGNMENT] = {};
+                pack.write(zeroes, entries[i].m_dataOffset - static_cast<u64>(position));
+                pack.write(buffer.data(), buffer.size());
+            }
+
+            if (!pack.good()) {
+                std::cout << "error: couldn't write " << out << '\n';
+                return discard();
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(temp_path, out, ec);
+        if (ec) {
+            std::filesystem::remove(temp_path, ec);
+            std::cout << "error: couldn't write " << out << '\n';
+            return -1;
+        }
+        return entries.size();
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "base.h"
+#include "mapped_file.h"
+#include <filesystem>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace dconstruct {
+    /*
+        a dcpack holds a whole folder of DC files in one file, so a corpus can be mapped once instead of opening
+        every file on its own.
+
+        DcPackHeader
+        DcPackEntry[m_numFiles]     sorted by path
+        paths                       relative to the packed folder, '/' separated, not null terminated
+        file data                   every file starts at a DCPACK_ALIGNMENT aligned offset
+    */
+    struct DcPackHeader {
+        u32 m_magic;
+        u32 m_version;
+        u64 m_numFiles;
+        u64 m_entriesOffset;
+        u64 m_pathsOffset;
+    };
+
+    struct DcPackEntry {
+        u64 m_dataOffset;
+        u64 m_size;
+        u64 m_pathOffset;
+        u64 m_pathLength;
+    };
+
+    constexpr u64 DCPACK_ALIGNMENT = 4096;
+
+    class DcPack {
+    public:
+        [[nodiscard]] b8 open(const std::filesystem::path& path, const MapAccess access) noexcept;
+
+        [[nodiscard]] std::span<const DcPackEntry> entries() const noexcept {
+            return m_entries;
+        }
+
+        [[nodiscard]] std::string_view path(const DcPackEntry& entry) const noexcept {
+            return { reinterpret_cast<const char*>(m_mapping.data() + entry.m_pathOffset), entry.m_pathLength };
+        }
+
+        [[nodiscard]] std::byte* data(const DcPackEntry& entry) const noexcept {
+            return m_mapping.data() + entry.m_dataOffset;
+        }
+
+        // gives the pages an entry was relocated into back, once nothing uses its data anymore.
+        // pages shared with another entry are kept.
+        void release(const DcPackEntry& entry) const noexcept {
+            m_mapping.discard(entry.m_dataOffset, m_releaseEnd[&entry - m_entries.data()]);
+        }
+
+    private:
+        MappedFile m_mapping;
+        std::span<const DcPackEntry> m_entries;
+        // for every entry, the start of the data that follows it
+        std::vector<u64> m_releaseEnd;
+    };
+
+    [[nodiscard]] b8 is_dcpack(const std::filesystem::path& path) noexcept;
+
+    // packs every .bin file below folder into out. returns the number of packed files, or -1 on failure.
+    [[nodiscard]] i64 write_dcpack(const std::filesystem::path& folder, const std::filesystem::path& out);
+}
@@ -15,7 +15,16 @@ namespace dconstruct {
         return res->second.c_str();
     }
 
-    const char *hash_string = m_sidbase->search(sid);
+    const char *hash_string = nullptr;
+    const ResolvedSid *resolved = m_currentFile->m_structIndex.resolved_sid(sid);
+    if (resolved != nullptr) {
+        if (resolved->m_sidbaseOffset != ResolvedSid::NOT_FOUND) {
+            hash_string = m_sidbase->string_at(resolved->m_sidbaseOffset);
+        }
+    } else {
+        hash_string = m_sidbase->search(sid);
+        m_currentFile->m_structIndex.record_sid(sid);
+    }
     if (hash_string == nullptr) {
         const std::string new_hash_string = int_to_string_id(sid);
         auto [iter, inserted] = m_currentFile->m_sidCache.emplace(sid, new_hash_string);
@@ -24,18 +33,43 @@ namespace dconstruct {
     return hash_string;
 }
 
+// strings in a relocated file already had their newlines replaced during setup, in OFFSETS mode the image
+// is left untouched, so they get replaced on the way out instead.
+[[nodiscard]] const char *Disassembler::printable(const char *str) noexcept {
+    if (str == nullptr || m_currentFile->m_decodeMode == DecodeMode::RELOCATED || strchr(str, '\n') == nullptr) {
+        return str;
+    }
+    m_printableBuffer = str;
+    std::replace(m_printableBuffer.begin(), m_printableBuffer.end(), '\n', ' ');
+    return m_printableBuffer.c_str();
+}
+
 template<TextFormat text_format, typename... Args>
-void Disassembler::insert_span_fmt(const char *format, Args ...args) {
-    char buffer[512];
-    snprintf(buffer, sizeof(buffer), format, args...);
-    insert_span(buffer, 0, text_format);
+void Disassembler::insert_span_fmt(const FormatString<std::type_identity_t<Args>...> format, Args ...args) {
+    if (m_discardText) {
+        return;
+    }
+    if (m_textOutput != nullptr) {
+        format_to(*m_textOutput, MAX_SPAN_LENGTH, format, args...);
+        return;
+    }
+    FormatBuffer<MAX_SPAN_LENGTH + 1> buffer;
+    format_to(buffer, MAX_SPAN_LENGTH, format, args...);
+    insert_span(buffer.c_str(), 0, text_format);
 }
 
 template<TextFormat text_format, typename... Args>
-void Disassembler::insert_span_indent(const char* format, const u32 indent, Args ...args) {
-    char buffer[512];
-    snprintf(buffer, sizeof(buffer), format, indent, "", args...);
-    insert_span(buffer, 0, text_format);
+void Disassembler::insert_span_indent(const FormatString<u32, const char*, std::type_identity_t<Args>...> format, const u32 indent, Args ...args) {
+    if (m_discardText) {
+        return;
+    }
+    if (m_textOutput != nullptr) {
+        format_to(*m_textOutput, MAX_SPAN_LENGTH, format, indent, "", args...);
+        return;
+    }
+    FormatBuffer<MAX_SPAN_LENGTH + 1> buffer;
+    format_to(buffer, MAX_SPAN_LENGTH, format, indent, "", args...);
+    insert_span(buffer.c_str(), 0, text_format);
 }
 
 [[nodiscard]] b8 Disassembler::is_sid(const location loc) const noexcept {
@@ -62,38 +96,31 @@ void Disassembler::insert_span_indent(const char* format, const u32 indent, Args
 
 */  
 u8 Disassembler::insert_struct_or_arraylike(const location struct_location, const u32 indent) noexcept {
-    u8 bytes_inserted = 0;
     if (m_currentFile->is_file_ptr(struct_location)) {
-        if (m_currentFile->is_string(location().from(struct_location))) {
-            insert_span_fmt("string: \"%s\"\n", struct_location.get<char*>());
-            bytes_inserted = 8;
-            return bytes_inserted;
-        }
-        const location next_struct_header = location().from(struct_location, -8);
-        if (!next_struct_header.is_aligned() || !is_sid(next_struct_header)) {
-            insert_anonymous_array(struct_location, indent);
-        } else if (next_struct_header.get<sid64>() == SID("array")) {
-            insert_array(struct_location, get_size_array(struct_location, indent), indent);
-        } else {
-            insert_struct(next_struct_header.as<structs::unmapped>(), indent);
-        }
-        bytes_inserted = 8;
+        insert_pointee(struct_location, indent);
+        return 8;
     }
-    else {
-        if (struct_location >= m_currentFile->m_strings) {
-            insert_span_fmt("string: \"%s\"\n", struct_location.get<char*>());
-            bytes_inserted = 8;
-        }
-        else {
-            bytes_inserted = insert_next_struct_member(struct_location, indent);
-        }
+    return insert_member(struct_location, classify_array_member(struct_location), indent);
+}
+
+void Disassembler::insert_pointee(const location pointer, const u32 indent) noexcept {
+    if (m_currentFile->is_string(m_currentFile->deref(pointer))) {
+        insert_span_fmt("string: \"%s\"\n", printable(m_currentFile->deref(pointer).as<char>()));
+        return;
+    }
+    const location next_struct_header = m_currentFile->deref(pointer) - 8;
+    if (!next_struct_header.is_aligned() || !is_sid(next_struct_header)) {
+        insert_anonymous_array(pointer, indent);
+    } else if (next_struct_header.get<sid64>() == SID("array")) {
+        insert_array(pointer, get_size_array(pointer, indent), indent);
+    } else {
+        insert_struct(next_struct_header.as<structs::unmapped>(), indent);
     }
-    return bytes_inserted;
 }
 
 void Disassembler::insert_anonymous_array(const location anon_array, const u32 indent) noexcept {
     const u32 anonymous_array_size = anon_array.get<u32>(8);
-    if (anonymous_array_size > 1024) {
+    if (anonymous_array_size > MAX_ANONYMOUS_ARRAY_SIZE) {
         insert_span_fmt("anonymous array with invalid size %u, returning\n", anonymous_array_size);
         return;
     }
@@ -102,29 +129,40 @@ void Disassembler::insert_anonymous_array(const location anon_array, const u32 i
     insert_array(anon_array, anonymous_array_size, indent);
 }
 
+[[nodiscard]] u32 Disassembler::read_array_size(const location array) const noexcept {
+    const u32 size_array_front = array.get<u32>(8);
+    const u32 size_array_back = array.get<u32>(-8);
+    if (size_array_front <= MAX_ARRAY_SIZE) {
+        return size_array_front;
+    }
+    if (size_array_back <= MAX_ARRAY_SIZE) {
+        return size_array_back;
+    }
+    return 0;
+}
+
 [[nodiscard]] u32 Disassembler::get_size_array(const location array, const u32 indent) noexcept {
-    u32 size_array_front = array.get<u32>(8);
-    u32 size_array_back = array.get<u32>(-8);
-    u32 size_array;
-    constexpr u32 max_allowed_size_array = 512;
-    if (size_array_front > max_allowed_size_array) {
-        if (size_array_back > max_allowed_size_array) {
-            insert_span_fmt("array [0x%x] {size: (%u, %u) (*invalid*)} {", 
-                get_offset(array), 
-                size_array_front,
-                size_array_back
-            );
-            return 0;
-        } else {
-            size_array = size_array_back;
-        }
-    } else {
-        size_array = size_array_front;
+    const u32 size_array_front = array.get<u32>(8);
+    const u32 size_array_back = array.get<u32>(-8);
+    if (size_array_front > MAX_ARRAY_SIZE && size_array_back > MAX_ARRAY_SIZE) {
+        insert_span_fmt("array [0x%x] {size: (%u, %u) (*invalid*)} {", 
+            get_offset(array), 
+            size_array_front,
+            size_array_back
+        );
+        return 0;
     }
+    const u32 size_array = read_array_size(array);
     insert_span_fmt("array [0x%x] {size: %d} {\n", get_offset(array), size_array);
     return size_array;
 }
 
+[[nodiscard]] u32 Disassembler::get_array_struct_size(const location first_member, const u32 array_size) const noexcept {
+    const u32 member_offset = m_currentFile->next_boundary(first_member + 8).num() - first_member.num();
+    const u8 type_id_padding = m_currentFile->is_string(first_member + member_offset) ? 0 : 8;
+    return (member_offset - type_id_padding) / array_size;
+}
+
 void Disassembler::insert_array(const location array, const u32 array_size, const u32 indent) {
     
     if (array_size == 0) {
@@ -132,90 +170,318 @@ void Disassembler::insert_array(const location array, const u32 array_size, cons
         return;
     }
 
-    u32 member_offset = 8;
-    u32 member_count = 0;
-    const location member = location().from(array);
-
-    while (!m_currentFile->is_string(member + member_offset) && !m_currentFile->gets_pointed_at(member + member_offset)) {
-        member_offset += 8;
-    }
-
-    const u8 type_id_padding = m_currentFile->is_string(member + member_offset) ? 0 : 8;
-    u32 struct_size = (member_offset - type_id_padding) / array_size;
+    const location member = m_currentFile->deref(array);
+    const u32 struct_size = get_array_struct_size(member, array_size);
+    std::vector<StructMember> members;
 
     for (u32 array_entry_count = 0; array_entry_count < array_size; ++array_entry_count) {
-        member_offset = member_count = 0;
+        const location element = member + array_entry_count * struct_size;
         insert_span_indent("%*s[%u] anonymous struct [0x%x] {\n", 
             indent + m_options.m_indentPerLevel, 
             array_entry_count,
-            get_offset(member + array_entry_count * struct_size)
+            get_offset(element)
         );
+        begin_struct(get_offset(element), 0);
+
+        const StructRecord* record = m_currentFile->m_structIndex.at(get_offset(element));
+        std::span<const StructMember> layout;
+        if (record != nullptr && record->m_typeId == 0 && record->m_size == struct_size) {
+            layout = m_currentFile->m_structIndex.members(*record);
+        } else {
+            members.clear();
+            walk_array_element(element, struct_size, members);
+            layout = members;
+        }
 
-        while (member_offset < struct_size) {
+        u32 member_count = 0;
+        for (const StructMember& struct_member : layout) {
             insert_span_indent("%*s[%d] ", indent + m_options.m_indentPerLevel * 2, member_count++);
-            const location current_member_location = member + (array_entry_count * struct_size + member_offset);
-            const u32 last_member_size = insert_struct_or_arraylike(current_member_location.aligned(), indent + m_options.m_indentPerLevel * 2);
-            member_offset += last_member_size ? last_member_size : 8;
+            insert_member(location(m_currentFile->m_bytes + struct_member.m_offset), struct_member.m_kind, indent + m_options.m_indentPerLevel * 2);
         }
 
         insert_span("}\n", indent + m_options.m_indentPerLevel);
+        end_struct();
     }
     insert_span("}\n", indent);
 }
 
 void Disassembler::insert_unmapped_struct(const structs::unmapped *struct_ptr, const u32 indent) {
+    const location member_start = location(&struct_ptr->m_data);
+    const StructRecord* record = m_currentFile->m_structIndex.at(get_offset(member_start));
+    std::vector<StructMember> members;
+    std::span<const StructMember> layout;
+    if (record != nullptr && record->m_typeId == struct_ptr->typeID && record->m_numMembers != 0) {
+        layout = m_currentFile->m_structIndex.members(*record);
+    } else {
+        walk_struct_members(member_start, members);
+        layout = members;
+    }
+
+    u32 member_count = 0;
+    for (const StructMember& member : layout) {
+        insert_span_indent("%*s[%d] ", indent, member_count++);
+        insert_member(location(m_currentFile->m_bytes + member.m_offset), member.m_kind, indent);
+    }
+}
+
+u8 Disassembler::insert_next_struct_member(const location member, const u32 indent) {
+    return insert_member(member, classify_member(member), indent);
+}
+
+u8 Disassembler::insert_member(const location member, const MemberKind kind, const u32 indent) {
+    insert_value(member, kind);
+    switch (kind) {
+        case MemberKind::POINTER: {
+            insert_pointee(member, indent);
+            break;
+        }
+        case MemberKind::STRING: {
+            insert_span_fmt("string: \"%s\"\n", printable(member.as<char>()));
+            break;
+        }
+        case MemberKind::RAW_STRING: {
+            insert_span_fmt("string: \"%s\"\n", printable(member.get<char*>()));
+            break;
+        }
+        case MemberKind::SID: {
+            insert_span_fmt("sid: %s\n", lookup(member.get<sid64>()));
+            break;
+        }
+        case MemberKind::FLOAT: {
+            insert_span_fmt("float: %.2f\n", member.get<f32>());
+            break;
+        }
+        case MemberKind::INT: {
+            insert_span_fmt("int: %d\n", member.get<i32>());
+            break;
+        }
+    }
+    return member_size(kind);
+}
+
+/*
+    the member layout of a struct isn't stored anywhere, so it has to be guessed from the values. members are either
+    8 byte pointers/sids or 4 byte floats/ints, and a struct ends where the next piece of data gets pointed at.
+    the guesses only depend on the file itself, so they're made once per struct in build_struct_index and
+    reused by everything that needs the layout afterwards.
+*/
+[[nodiscard]] MemberKind Disassembler::classify_member(const location member) noexcept {
+    if (m_currentFile->is_file_ptr(member)) {
+        return member >= m_currentFile->m_strings ? MemberKind::STRING : MemberKind::POINTER;
+    }
+    const sid64 hash = member.get<sid64>();
+    const char* hash_string = m_sidbase->search(hash);
+    if (hash_string != nullptr) {
+        // kept in the index, so that lookup() doesn't search for it again once the member gets printed
+        const u64 offset = m_sidbase->offset_of(hash_string);
+        if (offset != SID_NO_OFFSET) {
+            m_currentFile->m_structIndex.add_resolved_sid(ResolvedSid{ hash, offset });
+        }
+        return MemberKind::SID;
+    }
+    if (is_possible_float(member.as<f32>())) {
+        return MemberKind::FLOAT;
+    }
+    if (is_possible_i32(member.as<i32>())) {
+        return MemberKind::INT;
+    }
+    if (is_sid(member)) {
+        return MemberKind::SID;
+    }
+    return MemberKind::INT;
+}
+
+[[nodiscard]] MemberKind Disassembler::classify_array_member(const location member) noexcept {
+    if (m_currentFile->is_file_ptr(member)) {
+        return MemberKind::POINTER;
+    }
+    if (member >= m_currentFile->m_strings) {
+        return MemberKind::RAW_STRING;
+    }
+    return classify_member(member);
+}
+
+u32 Disassembler::walk_struct_members(const location member_start, std::vector<StructMember>& members) {
     u64 member_offset = 0;
     b8 offset_gets_pointed_at = false;
     u64 last_member_size = 0;
-    u32 member_count = 0;
-    const location member_start = location(&struct_ptr->m_data);
     location member_location = member_start;
+    // members are at most 8 bytes large, so the slot checked below never skips one. the next pointed-at slot
+    // only has to be looked up again once we've moved past it.
+    u64 boundary_slot = 0;
     while (!offset_gets_pointed_at) {
         member_offset += last_member_size;
-        insert_span_indent("%*s[%d] ", indent, member_count++);
-        last_member_size = insert_next_struct_member(member_start + member_offset, indent);
+        const MemberKind kind = classify_member(member_start + member_offset);
+        members.push_back(StructMember{ get_offset(member_start + member_offset), kind });
+        last_member_size = member_size(kind);
         member_location = member_start + (member_offset + last_member_size);
-        offset_gets_pointed_at = m_currentFile->gets_pointed_at(member_location + 8) || m_currentFile->is_string(member_location);
+        const u64 slot = m_currentFile->slot_of(member_location + 8);
+        if (slot > boundary_slot) {
+            boundary_slot = m_currentFile->next_pointed_at_slot(slot);
+        }
+        offset_gets_pointed_at = slot == boundary_slot || m_currentFile->is_string(member_location);
     }
+    return member_offset + last_member_size;
 }
 
-u8 Disassembler::insert_next_struct_member(const location member, const u32 indent) {
-    u8 member_size;
-    const char *str_ptr = nullptr;
-    if (m_currentFile->is_file_ptr(member)) {
-        if (member >= m_currentFile->m_strings) {
-            insert_span_fmt("string: \"%s\"\n", member.as<char>());
+void Disassembler::walk_array_element(const location element, const u32 struct_size, std::vector<StructMember>& members) {
+    u32 member_offset = 0;
+    while (member_offset < struct_size) {
+        const location member = (element + member_offset).aligned();
+        const MemberKind kind = classify_array_member(member);
+        members.push_back(StructMember{ get_offset(member), kind });
+        member_offset += member_size(kind);
+    }
+}
+
+void Disassembler::build_struct_index() {
+    StructIndex& index = m_currentFile->m_structIndex;
+    if (index.is_built()) {
+        return;
+    }
+    for (i32 i = 0; i < m_currentFile->m_dcheader->m_numEntries; ++i) {
+        const Entry* entry = m_currentFile->resolve(m_currentFile->m_dcheader->m_pStartOfData) + i;
+        index_struct(reinterpret_cast<const structs::unmapped*>(reinterpret_cast<const u64*>(m_currentFile->resolve(entry->m_entryPtr)) - 1), StructIndex::NO_PARENT);
+    }
+    index.finalize();
+}
+
+void Disassembler::index_struct(const structs::unmapped* struct_ptr, const u32 parent) {
+    StructIndex& index = m_currentFile->m_structIndex;
+    const location member_start = location(&struct_ptr->m_data);
+    const u32 row = index.add(struct_ptr->typeID, get_offset(member_start), parent);
+    if (row == StructIndex::NO_PARENT) {
+        return;
+    }
+
+    switch (struct_ptr->typeID) {
+        case SID("state-script"): {
+            index.set_members(row, {}, m_currentFile->next_boundary(member_start + 8).num() - member_start.num());
+            index_state_script(reinterpret_cast<const StateScript*>(&struct_ptr->m_data));
+            break;
         }
-        else {
-            insert_struct_or_arraylike(member, indent);
+        case SID("script-lambda"): {
+            index.set_members(row, {}, m_currentFile->next_boundary(member_start + 8).num() - member_start.num());
+            index_function(reinterpret_cast<const ScriptLambda*>(&struct_ptr->m_data));
+            break;
+        }
+        case SID("map"):
+        case SID("map-32"): {
+            index.set_members(row, {}, m_currentFile->next_boundary(member_start + 8).num() - member_start.num());
+            const structs::map *map = reinterpret_cast<const structs::map*>(&struct_ptr->m_data);
+            const structs::array values = { m_currentFile->resolve(map->values.data) };
+            for (u64 i = 0; i < map->size; ++i) {
+                index_struct(reinterpret_cast<const structs::unmapped*>(m_currentFile->resolve(values[i]) - 8), row);
+            }
+            break;
+        }
+        default: {
+            std::vector<StructMember> members;
+            const u32 size = walk_struct_members(member_start, members);
+            index.set_members(row, members, size);
+            index_pointees(members, row);
+            break;
         }
-        member_size = 8;
     }
-    else if ((str_ptr = m_sidbase->search(member.get<sid64>())) != nullptr) {
-        insert_span_fmt("sid: %s\n", str_ptr);
-        member_size = 8;
+}
+
+void Disassembler::index_state_script(const StateScript* state_script) {
+    for (i16 i = 0; i < state_script->m_stateCount; ++i) {
+        const SsState *state_ptr = m_currentFile->resolve(state_script->m_pSsStateTable) + i;
+        for (i64 j = 0; j < state_ptr->m_numSsOnBlocks; ++j) {
+            const SsOnBlock *block = m_currentFile->resolve(state_ptr->m_pSsOnBlocks) + j;
+            for (i16 k = 0; k < block->m_trackGroup.m_numTracks; ++k) {
+                const SsTrack *track_ptr = m_currentFile->resolve(block->m_trackGroup.m_aTracks) + k;
+                for (i16 l = 0; l < track_ptr->m_totalLambdaCount; ++l) {
+                    index_function(m_currentFile->resolve(m_currentFile->resolve(track_ptr->m_pSsLambda)[l].m_pScriptLambda));
+                }
+            }
+        }
     }
-    else if (is_possible_float(member.as<f32>())) {
-        insert_span_fmt("float: %.2f\n", member.get<f32>());
-        member_size = 4;
+}
+
+// the arguments are moved into the registers starting at 49 by the first instructions
+[[nodiscard]] static u32 count_args(const Instruction* instructions, const u64 count) noexcept {
+    u32 num_args = 0;
+    while (num_args < count && instructions[num_args].operand1 >= 49) {
+        ++num_args;
+    }
+    return num_args;
+}
+
+void Disassembler::index_function(const ScriptLambda* lambda) {
+    const Instruction *instruction_ptr = reinterpret_cast<const Instruction*>(m_currentFile->resolve(lambda->m_pOpcode));
+    const u64 *symbol_table = m_currentFile->resolve(lambda->m_pSymbols);
+    const u64 num_instructions = reinterpret_cast<const Instruction*>(symbol_table) - instruction_ptr;
+    m_currentFile->m_structIndex.add_function(FunctionRecord{
+        get_offset(lambda),
+        get_offset(instruction_ptr),
+        static_cast<u32>(num_instructions),
+        get_offset(symbol_table),
+        count_args(instruction_ptr, num_instructions),
+    });
+}
+
+void Disassembler::index_pointees(const std::span<const StructMember> members, const u32 parent) {
+    for (const StructMember& member : members) {
+        if (member.m_kind != MemberKind::POINTER) {
+            continue;
+        }
+        const location pointer = location(m_currentFile->m_bytes + member.m_offset);
+        const location target = m_currentFile->deref(pointer);
+        if (m_currentFile->is_string(target)) {
+            continue;
+        }
+        const location next_struct_header = target - 8;
+        if (!next_struct_header.is_aligned() || !is_sid(next_struct_header)) {
+            const u32 anonymous_array_size = pointer.get<u32>(8);
+            if (anonymous_array_size <= MAX_ANONYMOUS_ARRAY_SIZE) {
+                index_array(pointer, anonymous_array_size, parent);
+            }
+        } else if (next_struct_header.get<sid64>() == SID("array")) {
+            index_array(pointer, read_array_size(pointer), parent);
+        } else {
+            index_struct(next_struct_header.as<structs::unmapped>(), parent);
+        }
     }
-    else if (is_possible_i32(member.as<i32>())) {
-        insert_span_fmt("int: %d\n", member.get<i32>());
-        member_size = 4;
+}
+
+void Disassembler::index_array(const location array, const u32 array_size, const u32 parent) {
+    if (array_size == 0) {
+        return;
     }
-    else if (is_sid(member)) {
-        str_ptr = lookup(member.get<sid64>());
-        insert_span_fmt("sid: %s\n", str_ptr);
-        member_size = 8;
+    StructIndex& index = m_currentFile->m_structIndex;
+    const location member = m_currentFile->deref(array);
+    const u32 struct_size = get_array_struct_size(member, array_size);
+    std::vector<StructMember> members;
+    for (u32 i = 0; i < array_size; ++i) {
+        const location element = member + i * struct_size;
+        const u32 row = index.add(0, get_offset(element), parent);
+        if (row == StructIndex::NO_PARENT) {
+            continue;
+        }
+        members.clear();
+        walk_array_element(element, struct_size, members);
+        index.set_members(row, members, struct_size);
+        index_pointees(members, row);
     }
-    else {
-        insert_span_fmt("int: %d\n", member.get<i32>());
-        member_size = 4;
+}
+
+void Disassembler::reindex_struct(const StructRecord& record) {
+    StructIndex& index = m_currentFile->m_structIndex;
+    const location member_start = location(m_currentFile->m_bytes + record.m_offset);
+    std::vector<StructMember> members;
+    if (record.m_typeId == 0) {
+        walk_array_element(member_start, record.m_size, members);
+        index.set_members(index.index_of(record), members, record.m_size);
+    } else {
+        const u32 size = walk_struct_members(member_start, members);
+        index.set_members(index.index_of(record), members, size);
     }
-    return member_size;
 }
 
 void Disassembler::disassemble() {
+    build_struct_index();
     insert_header_line();
     for (i32 i = 0; i < m_currentFile->m_dcheader->m_numEntries; ++i) {
         insert_span("\n\n");
@@ -223,13 +489,15 @@ void Disassembler::disassemble() {
         insert_span_fmt("  ENTRY %u  ", i);
         insert_span(ENTRY_SEP);
         insert_span("\n\n");
-        insert_entry(m_currentFile->m_dcheader->m_pStartOfData + i);
+        const Entry* entry = m_currentFile->resolve(m_currentFile->m_dcheader->m_pStartOfData) + i;
+        begin_entry(i, entry);
+        insert_entry(entry);
     }
     complete();
 }
 
 void Disassembler::insert_entry(const Entry *entry) {
-    const structs::unmapped *struct_ptr = reinterpret_cast<const structs::unmapped*>(reinterpret_cast<const u64*>(entry->m_entryPtr) - 1);
+    const structs::unmapped *struct_ptr = reinterpret_cast<const structs::unmapped*>(reinterpret_cast<const u64*>(m_currentFile->resolve(entry->m_entryPtr)) - 1);
     insert_span_fmt("%s = ", lookup(entry->m_nameID));
     insert_struct(struct_ptr, 0, entry->m_nameID);
 }
@@ -240,6 +508,7 @@ void Disassembler::insert_struct(const structs::unmapped *struct_ptr, const u32
     const u64 offset = get_offset(&struct_ptr->m_data);
 
     insert_span_fmt("%s [0x%05X] {\n", lookup(struct_ptr->typeID), offset);
+    begin_struct(offset, struct_ptr->typeID);
 
     switch (struct_ptr->typeID) {
         case SID("state-script"): {
@@ -254,6 +523,7 @@ void Disassembler::insert_struct(const structs::unmapped *struct_ptr, const u32
                 dcompiler.decompile();
             }
             std::unique_ptr<FunctionDisassembly> function = std::make_unique<FunctionDisassembly>(std::move(afunction));
+            insert_function(reinterpret_cast<const ScriptLambda*>(&struct_ptr->m_data), *function);
             insert_function_disassembly_text(*function, indent + m_options.m_indentPerLevel * 2);
             m_currentFile->m_functions.push_back(std::move(function));
             break;
@@ -261,11 +531,14 @@ void Disassembler::insert_struct(const structs::unmapped *struct_ptr, const u32
         case SID("map"):
         case SID("map-32"): {
             const structs::map *map = reinterpret_cast<const structs::map*>(&struct_ptr->m_data);
-            insert_span_indent("%*skeys: [0x%05X], values: [0x%05X]\n\n", indent + m_options.m_indentPerLevel, get_offset(map->keys.data), get_offset(map->values.data));
+            const structs::array keys = { m_currentFile->resolve(map->keys.data) };
+            const structs::array values = { m_currentFile->resolve(map->values.data) };
+            insert_span_indent("%*skeys: [0x%05X], values: [0x%05X]\n\n", indent + m_options.m_indentPerLevel, get_offset(keys.data), get_offset(values.data));
             for (u64 i = 0; i < map->size; ++i) {
-                const char *key_hash = lookup(map->keys[i]);
+                const char *key_hash = lookup(keys[i]);
                 insert_span_indent("%*s%s {\n%*s", indent + m_options.m_indentPerLevel, key_hash, indent + m_options.m_indentPerLevel * 2, "");
-                const structs::unmapped *struct_ptr = reinterpret_cast<const structs::unmapped*>(map->values[i] - 8);
+                const structs::unmapped *struct_ptr = reinterpret_cast<const structs::unmapped*>(m_currentFile->resolve(values[i]) - 8);
+                insert_map_key(keys[i]);
                 insert_struct(struct_ptr, indent + m_options.m_indentPerLevel * 2);
                 insert_span("}\n", indent + m_options.m_indentPerLevel);
             }
@@ -274,6 +547,7 @@ void Disassembler::insert_struct(const structs::unmapped *struct_ptr, const u32
         default: {
             if (m_options.m_emitOnce && m_currentFile->m_emittedStructs.find(reinterpret_cast<p64>(struct_ptr)) != m_currentFile->m_emittedStructs.end()) {
                 insert_span_indent("%*sALREADY EMITTED\n%*s}\n", indent + m_options.m_indentPerLevel, indent, "");
+                end_struct();
                 return;
             }
             insert_unmapped_struct(struct_ptr, indent + m_options.m_indentPerLevel);
@@ -281,6 +555,7 @@ void Disassembler::insert_struct(const structs::unmapped *struct_ptr, const u32
         }
     }
     insert_span("}\n", indent);
+    end_struct();
     if (m_options.m_emitOnce) {
         m_currentFile->m_emittedStructs.emplace(reinterpret_cast<p64>(struct_ptr));
     }
@@ -296,7 +571,8 @@ void Disassembler::insert_struct(const structs::unmapped *struct_ptr, const u32
 
 void Disassembler::insert_variable(const SsDeclaration *var, const u32 indent) {
     b8 is_nullptr = var->m_pDeclValue == nullptr;
-
+    void *decl_value = m_currentFile->resolve(var->m_pDeclValue);
+    insert_declaration(var);
 
     insert_span_indent("%*s[0x%06X] ",  indent, get_offset(var));
     insert_span_fmt("%-8s ", lookup(var->m_declTypeId));
@@ -305,69 +581,69 @@ void Disassembler::insert_variable(const SsDeclaration *var, const u32 indent) {
     switch (var->m_declTypeId) {
         case SID("boolean"): {
             if (!is_nullptr) 
-                insert_span(*reinterpret_cast<b8*>(var->m_pDeclValue) ? "true" : "false");
+                insert_span(*reinterpret_cast<b8*>(decl_value) ? "true" : "false");
             break;
         }
         case SID("vector"): {
             if (!is_nullptr) {
-                f32 *val = reinterpret_cast<f32*>(var->m_pDeclValue);
+                f32 *val = reinterpret_cast<f32*>(decl_value);
                 insert_span_fmt("(%.2f, %.2f, %.2f, %.2f)", val[0], val[1], val[2], val[3]);
             }
             break;
         }
         case SID("quat"): {
             if (!is_nullptr) {
-                f32 *val = reinterpret_cast<f32*>(var->m_pDeclValue);
+                f32 *val = reinterpret_cast<f32*>(decl_value);
                 insert_span_fmt("(%.2f, %.2f, %.2f, %.2f)", val[0], val[1], val[2], val[3]);
             }
             break;
         }
         case SID("float"): {
             if (!is_nullptr) {
-                insert_span_fmt("%.2f", *reinterpret_cast<f32*>(var->m_pDeclValue));
+                insert_span_fmt("%.2f", *reinterpret_cast<f32*>(decl_value));
             }
             break;
         }
         case SID("string"): {
             if (!is_nullptr) {
-                insert_span_fmt("%s", *reinterpret_cast<const char**>(var->m_pDeclValue));
+                insert_span_fmt("%s", printable(m_currentFile->resolve(*reinterpret_cast<const char**>(decl_value))));
             }
             break;
         }
         case SID("symbol"): {
             if (!is_nullptr) {
-                insert_span(lookup(*reinterpret_cast<sid64*>(var->m_pDeclValue)));
+                insert_span(lookup(*reinterpret_cast<sid64*>(decl_value)));
             }
             break;
         }
         case SID("int32"): {
             if (!is_nullptr) {
-                insert_span_fmt("%i", *reinterpret_cast<i32*>(var->m_pDeclValue));
+                insert_span_fmt("%i", *reinterpret_cast<i32*>(decl_value));
             }
             break;
         }
         case SID("uint64"): {
             if (!is_nullptr) {
-                insert_span_fmt("%llx", *reinterpret_cast<u64*>(var->m_pDeclValue));
+                insert_span_fmt("%llx", *reinterpret_cast<u64*>(decl_value));
             }
             break;
         }
         case SID("timer"): {
             if (!is_nullptr) {
-                insert_span_fmt("%f", *reinterpret_cast<f32*>(var->m_pDeclValue));
+                insert_span_fmt("%f", *reinterpret_cast<f32*>(decl_value));
             }
             break;
         }
         case SID("point"): {
             if (!is_nullptr) {
-                f32 *val = reinterpret_cast<f32*>(var->m_pDeclValue);
+                f32 *val = reinterpret_cast<f32*>(decl_value);
                 insert_span_fmt("(%.2f, %.2f, %.2f)", val[0], val[1], val[2]);
             }
             break;
         }
         case SID("bound-frame"): {
             if (!is_nullptr) {
-                insert_span_fmt("%f", *reinterpret_cast<f32*>(var->m_pDeclValue));
+                insert_span_fmt("%f", *reinterpret_cast<f32*>(decl_value));
             }
             break;
         }
@@ -411,11 +687,13 @@ void Disassembler::insert_on_block(const SsOnBlock *block, const u32 indent) {
     }
 
     for (i16 i = 0; i < block->m_trackGroup.m_numTracks; ++i) {
-        SsTrack *track_ptr = block->m_trackGroup.m_aTracks + i;
+        SsTrack *track_ptr = m_currentFile->resolve(block->m_trackGroup.m_aTracks) + i;
         insert_span_indent("%*sTRACK %s {\n", indent + m_options.m_indentPerLevel, lookup(track_ptr->m_trackId));
         for (i16 j = 0; j < track_ptr->m_totalLambdaCount; ++j) {
             insert_span("{\n", indent + m_options.m_indentPerLevel * 2);
-            std::unique_ptr<FunctionDisassembly> function = std::make_unique<FunctionDisassembly>(std::move(create_function_disassembly(track_ptr->m_pSsLambda[j].m_pScriptLambda)));
+            const ScriptLambda* lambda = m_currentFile->resolve(m_currentFile->resolve(track_ptr->m_pSsLambda)[j].m_pScriptLambda);
+            std::unique_ptr<FunctionDisassembly> function = std::make_unique<FunctionDisassembly>(std::move(create_function_disassembly(lambda)));
+            insert_function(lambda, *function);
             insert_function_disassembly_text(*function, indent + m_options.m_indentPerLevel * 3);
             m_currentFile->m_functions.push_back(std::move(function));
             insert_span("}\n", indent + m_options.m_indentPerLevel * 2);
@@ -428,44 +706,58 @@ void Disassembler::insert_on_block(const SsOnBlock *block, const u32 indent) {
 
 void Disassembler::insert_state_script(const StateScript *stateScript, const u32 indent) {
 
-    if (stateScript->m_pSsOptions != nullptr && stateScript->m_pSsOptions->m_pSymbolArray != nullptr) {
-        SymbolArray *s_array = stateScript->m_pSsOptions->m_pSymbolArray;
+    const SsOptions *options = m_currentFile->resolve(stateScript->m_pSsOptions);
+    if (options != nullptr && options->m_pSymbolArray != nullptr) {
+        SymbolArray *s_array = m_currentFile->resolve(options->m_pSymbolArray);
+        const sid64 *symbols = m_currentFile->resolve(s_array->m_pSymbols);
         insert_span("OPTIONS: ", indent);
         for (i32 i = 0; i < s_array->m_numEntries; ++i) {
-            insert_span(lookup(s_array->m_pSymbols[i]), indent + m_options.m_indentPerLevel);
+            insert_span(lookup(symbols[i]), indent + m_options.m_indentPerLevel);
             insert_span("\n");
         }
     }
 
-    SsDeclarationList *decl_table = stateScript->m_pSsDeclList;
+    SsDeclarationList *decl_table = m_currentFile->resolve(stateScript->m_pSsDeclList);
     if (decl_table != nullptr) {
         insert_span("DECLARATIONS: \n", indent);
         for (i32 i = 0; i < decl_table->m_numDeclarations; ++i) {
-            SsDeclaration *decl = decl_table->m_pDeclarations + i;
+            SsDeclaration *decl = m_currentFile->resolve(decl_table->m_pDeclarations) + i;
             if (decl->m_isVar) {
                 insert_variable(decl, indent + m_options.m_indentPerLevel);
             }
         }
     }
     for (i16 i = 0; i < stateScript->m_stateCount; ++i) {
-        SsState *state_ptr = stateScript->m_pSsStateTable + i;
-        const char *state_name = lookup(state_ptr->m_stateId);
-        insert_span_indent("%*sSTATE %s {\n", indent + m_options.m_indentPerLevel, state_name);
+        SsState *state_ptr = m_currentFile->resolve(stateScript->m_pSsStateTable) + i;
+        const std::string state_name = lookup(state_ptr->m_stateId);
+        insert_span_indent("%*sSTATE %s {\n", indent + m_options.m_indentPerLevel, state_name.c_str());
         for (i64 j = 0; j < state_ptr->m_numSsOnBlocks; ++j) {
-            insert_on_block(state_ptr->m_pSsOnBlocks + j, indent + m_options.m_indentPerLevel * 2);
+            insert_on_block(m_currentFile->resolve(state_ptr->m_pSsOnBlocks) + j, indent + m_options.m_indentPerLevel * 2);
         }
-        insert_span_indent("%*s} END STATE %s\n\n", indent + m_options.m_indentPerLevel, state_name);
+        insert_span_indent("%*s} END STATE %s\n\n", indent + m_options.m_indentPerLevel, state_name.c_str());
     }
 }
 
 [[nodiscard]] FunctionDisassembly Disassembler::create_function_disassembly(const ScriptLambda *lambda, const sid64 name_id) {
-    Instruction *instructionPtr = reinterpret_cast<Instruction*>(lambda->m_pOpcode);
-    const u64 instructionCount = reinterpret_cast<Instruction*>(lambda->m_pSymbols) - instructionPtr;
+    // the index already knows where the lambda's code and symbol table are and how many arguments it takes
+    const FunctionRecord *record = m_currentFile->m_structIndex.function_at(get_offset(lambda));
+    Instruction *instructionPtr;
+    const u64 *symbolTable;
+    u64 instructionCount;
+    if (record != nullptr) {
+        instructionPtr = reinterpret_cast<Instruction*>(m_currentFile->m_bytes + record->m_codeOffset);
+        symbolTable = reinterpret_cast<const u64*>(m_currentFile->m_bytes + record->m_symbolTableOffset);
+        instructionCount = record->m_numInstructions;
+    } else {
+        instructionPtr = reinterpret_cast<Instruction*>(m_currentFile->resolve(lambda->m_pOpcode));
+        symbolTable = m_currentFile->resolve(lambda->m_pSymbols);
+        instructionCount = reinterpret_cast<const Instruction*>(symbolTable) - instructionPtr;
+    }
 
     std::vector<FunctionDisassemblyLine> lines;
     lines.reserve(instructionCount);
     
-    const std::string name = name_id ? lookup(name_id) : "anonymous@" + std::to_string(get_offset(lambda->m_pOpcode));
+    const std::string name = name_id ? lookup(name_id) : "anonymous@" + std::to_string(get_offset(instructionPtr));
 
     FunctionDisassembly functionDisassembly {
         std::move(lines),
@@ -473,23 +765,15 @@ void Disassembler::insert_state_script(const StateScript *stateScript, const u32
         name
     };
 
-    functionDisassembly.m_stackFrame.m_symbolTable = location(lambda->m_pSymbols);
+    functionDisassembly.m_stackFrame.m_symbolTable = location(symbolTable);
+    functionDisassembly.m_stackFrame.m_argCount = record != nullptr ? record->m_numArgs : count_args(instructionPtr, instructionCount);
 
     for (u64 i = 0; i < instructionCount; ++i) {
         functionDisassembly.m_lines.emplace_back(i, instructionPtr);
     }
 
-    b8 counting_args = true;
-
     for (u64 i = 0; i < instructionCount; ++i) {
         process_instruction(functionDisassembly.m_stackFrame, functionDisassembly.m_lines[i]);
-        if (counting_args) {
-            if (functionDisassembly.m_lines[i].m_instruction.operand1 >= 49) {
-                functionDisassembly.m_stackFrame.m_argCount++;
-            } else {
-                counting_args = false;
-            }
-        }
     }
     return functionDisassembly;
 }
@@ -638,7 +922,8 @@ void Disassembler::process_instruction(StackFrame &stackFrame, FunctionDisassemb
             break;
         }
         case LoadStaticPointer: {
-            const p64 table_value = stackFrame.m_symbolTable.get<p64>(istr.operand1 * 8);
+            const location slot = stackFrame.m_symbolTable + (istr.operand1 * 8);
+            const p64 table_value = m_currentFile->deref(slot).num();
             table_entry.m_type = SymbolTableEntryType::POINTER;
             table_entry.m_pointer = table_value;
             snprintf(varying, disassembly_text_size,"r%d, %d", istr.destination, istr.operand1);
@@ -734,14 +1019,15 @@ void Disassembler::process_instruction(StackFrame &stackFrame, FunctionDisassemb
         }
         case LookupPointer: {
             snprintf(varying, disassembly_text_size,"r%d, %d", istr.destination, istr.operand1);
-            const p64 value = stackFrame.m_symbolTable.get<p64>(istr.operand1 * 8);
+            const location slot = stackFrame.m_symbolTable + (istr.operand1 * 8);
+            const p64 value = m_currentFile->deref(slot).num();
             dest.m_type = RegisterValueType::R_POINTER;
             dest.m_PTR.m_base = 0;
             dest.m_PTR.m_offset = 0;
             dest.m_PTR.m_sid = value;
             table_entry.m_type = SymbolTableEntryType::POINTER;
             table_entry.m_pointer = value;
-            if (m_currentFile->is_file_ptr(stackFrame.m_symbolTable + (istr.operand1 * 8))) {
+            if (m_currentFile->is_file_ptr(slot)) {
                snprintf(interpreted, interpreted_buffer_size, "r%d = ST[%d] -> <%s>", istr.destination, istr.operand1, reinterpret_cast<const char*>(value));
             } else {
                 snprintf(interpreted, interpreted_buffer_size, "r%d = ST[%d] -> <%s>", istr.destination, istr.operand1, lookup(value));
@@ -1177,7 +1463,8 @@ void Disassembler::process_instruction(StackFrame &stackFrame, FunctionDisassemb
         }
         case LoadStaticPointerImm: {
             snprintf(varying, disassembly_text_size,"r%d, %d", istr.destination, istr.operand1);
-            p64 value = stackFrame.m_symbolTable.get<p64>(istr.operand1 * 8);
+            const location slot = stackFrame.m_symbolTable + (istr.operand1 * 8);
+            p64 value = m_currentFile->deref(slot).num();
             if (value >= m_currentFile->m_strings.num()) {
                 snprintf(interpreted, interpreted_buffer_size, "r%d = ST[%d] -> \"%s\"", istr.destination, istr.operand1, reinterpret_cast<const char*>(value));
                 dest.m_type = RegisterValueType::R_STRING;
@@ -1388,6 +1675,9 @@ void Disassembler::process_instruction(StackFrame &stackFrame, FunctionDisassemb
     if (table_entry.m_type != NONE) {
         stackFrame.symbolTableEntries.emplace(istr.operand1, table_entry);
     }
+    if (m_currentFile->m_decodeMode == DecodeMode::OFFSETS) {
+        std::replace(interpreted, interpreted + strlen(interpreted), '\n', ' ');
+    }
     line.m_text = std::string(disassembly_text);
     line.m_comment = std::string(interpreted);
 }
@@ -1455,7 +1745,7 @@ void Disassembler::insert_function_disassembly_text(const FunctionDisassembly &f
                 break;
             }
             case SymbolTableEntryType::STRING: {
-                snprintf(type, sizeof(type), "string: \"%s\"\n", reinterpret_cast<const char*>(entry.m_pointer));
+                snprintf(type, sizeof(type), "string: \"%s\"\n", printable(reinterpret_cast<const char*>(entry.m_pointer)));
                 break;
             }
             case SymbolTableEntryType::POINTER:{
@@ -4,6 +4,8 @@
 #include "binaryfile.h"
 #include "instructions.h"
 #include "custom_structs.h"
+#include "format.h"
+#include "output_stream.h"
 #include <vector>
 
 namespace dconstruct {
@@ -27,9 +29,17 @@ namespace dconstruct {
         u64 m_fontSize = 14;
     };
 
+    enum class ListingFormat : u8 {
+        TEXT,
+        NDJSON,
+    };
+
     struct DisassemblerOptions {
         u8 m_indentPerLevel = 2;
         b8 m_emitOnce = false;
+        OutputOptions m_output{};
+        ListingFormat m_format = ListingFormat::TEXT;
+        b8 m_writeIr = false;
     };
 
     class Disassembler {
@@ -42,37 +52,73 @@ namespace dconstruct {
         virtual void insert_span(const char* text, const u32 indent = 0, const TextFormat& text_format = TextFormat{}) = 0;
         virtual void complete() = 0;
 
+        // the structure behind the text, for subclasses that write it out in another form. they're called from the
+        // same traversal in listing order, and every begin_struct is followed by an end_struct.
+        virtual void begin_entry(const u32 index, const Entry* entry) {}
+        virtual void insert_map_key(const sid64 key) {}
+        virtual void begin_struct(const u32 offset, const sid64 type_id) {}
+        virtual void end_struct() {}
+        virtual void insert_value(const location member, const MemberKind kind) {}
+        virtual void insert_declaration(const SsDeclaration* var) {}
+        virtual void insert_function(const ScriptLambda* lambda, const FunctionDisassembly& function) {}
+
         BinaryFile* m_currentFile = nullptr;
         const SIDBase* m_sidbase = nullptr;
         DisassemblerOptions m_options;
 
         std::map<sid64, std::vector<const structs::unmapped*>> m_unmappedEntries;
+        std::string m_printableBuffer;
+        // subclasses that only collect plain text point this at it, and formatted spans are written straight into it
+        OutputStream* m_textOutput = nullptr;
+        // subclasses that don't want the text at all set this, and formatted spans are skipped instead of formatted
+        b8 m_discardText = false;
 
         constexpr static TextFormat ENTRY_HEADER_FMT = { VAR_COLOR, 20 };
         constexpr static TextFormat ENTRY_TYPE_FMT = { TYPE_COLOR, 20 };
         constexpr static TextFormat STRUCT_TYPE_FMT = { TYPE_COLOR, 14 };
         constexpr static TextFormat COMMENT_FMT = { COMMENT_COLOR, 14 };
 
+        constexpr static u32 MAX_ARRAY_SIZE = 512;
+        // formatted spans used to go through a 512 byte buffer, which cut off anything longer
+        constexpr static u64 MAX_SPAN_LENGTH = 511;
+        constexpr static u32 MAX_ANONYMOUS_ARRAY_SIZE = 1024;
+
         FILE* m_perfFile = nullptr;
 
         void insert_entry(const Entry* entry);
         void insert_struct(const structs::unmapped* entry, const u32 indent = 0, const sid64 name_id = 0);
         template<TextFormat text_format = TextFormat{}, typename... Args> 
-        void insert_span_fmt(const char* format, Args ...args);
+        void insert_span_fmt(const FormatString<std::type_identity_t<Args>...> format, Args ...args);
         template<TextFormat text_format = TextFormat{}, typename... Args> 
-        void insert_span_indent(const char* format, const u32 indent, Args ...args);
+        void insert_span_indent(const FormatString<u32, const char*, std::type_identity_t<Args>...> format, const u32 indent, Args ...args);
         [[nodiscard]] const char* lookup(const sid64 hash) noexcept;
+        [[nodiscard]] const char* printable(const char* str) noexcept;
         [[nodiscard]] b8 is_sid(const location) const noexcept;
         void insert_header_line();
         [[nodiscard]] b8 is_possible_float(const f32* ptr) const noexcept;
         [[nodiscard]] b8 is_possible_i32(const i32* ptr) const noexcept;
         u8 insert_struct_or_arraylike(const location, const u32) noexcept;
+        void insert_pointee(const location, const u32) noexcept;
+        [[nodiscard]] u32 read_array_size(const location) const noexcept;
         [[nodiscard]] u32 get_size_array(const location, const u32) noexcept;
+        [[nodiscard]] u32 get_array_struct_size(const location, const u32) const noexcept;
         void insert_anonymous_array(const location, const u32) noexcept;
         void insert_array(const location, const u32, const u32);
         void insert_state_script(const StateScript* stateScript, const u32 indent);
         void insert_unmapped_struct(const structs::unmapped* _struct, const u32 indent);
         u8 insert_next_struct_member(const location, const u32);
+        u8 insert_member(const location, const MemberKind, const u32);
+        [[nodiscard]] MemberKind classify_member(const location) noexcept;
+        [[nodiscard]] MemberKind classify_array_member(const location) noexcept;
+        u32 walk_struct_members(const location member_start, std::vector<StructMember>& members);
+        void walk_array_element(const location element, const u32 struct_size, std::vector<StructMember>& members);
+        void build_struct_index();
+        void index_struct(const structs::unmapped* struct_ptr, const u32 parent);
+        void index_state_script(const StateScript* state_script);
+        void index_function(const ScriptLambda* lambda);
+        void index_pointees(const std::span<const StructMember> members, const u32 parent);
+        void index_array(const location array, const u32 array_size, const u32 parent);
+        void reindex_struct(const StructRecord& record);
         void insert_variable(const SsDeclaration* var, const u32);
         void insert_on_block(const SsOnBlock* block, const u32);
         [[nodiscard]] FunctionDisassembly create_function_disassembly(const ScriptLambda* lambda, const sid64 name_id = 0);
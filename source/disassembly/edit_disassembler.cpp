@@ -31,7 +31,7 @@ namespace dconstruct {
         else if (str_value[0] == '0' && str_value[1] == 'x') {
             return {
                 .m_editType = EditType::PTR,
-                .u64 = std::stoull(str_value, nullptr, 0) + reinterpret_cast<p64>(m_currentFile->m_bytes.get())
+                .u64 = std::stoull(str_value, nullptr, 0) + reinterpret_cast<p64>(m_currentFile->m_bytes)
             };
         }
         else {
@@ -43,14 +43,32 @@ namespace dconstruct {
     }
 
     void EditDisassembler::apply_edit(const u64 struct_offset, const u32 member_index, const BinaryFileEdit& value) noexcept {
-        const location struct_member_start = location(m_currentFile->m_bytes.get()) + struct_offset;
-        u32 member_location = 0;
-        u32 last_member_size = 0;
-        for (u32 i = 0; i < member_index; ++i) {
-            last_member_size = insert_next_struct_member(struct_member_start + member_location, 0);
-            member_location += last_member_size;
+        const StructRecord* record = m_currentFile->m_structIndex.at(struct_offset);
+        location edit_location;
+        u32 edit_member_size;
+        if (record != nullptr && record->m_numMembers != 0) {
+            const std::span<const StructMember> members = m_currentFile->m_structIndex.members(*record);
+            if (member_index >= members.size()) {
+                std::cout << "warning: struct at location 0x" << std::hex << struct_offset << " only has " << std::dec << members.size()
+                    << " members, but member " << member_index << " was specified. edit will not be applied.\n";
+                return;
+            }
+            edit_location = location(m_currentFile->m_bytes + members[member_index].m_offset);
+            edit_member_size = member_size(members[member_index].m_kind);
+        } else {
+            // not the start of a known struct, so the members are guessed from struct_offset onwards
+            const StructRecord* container = m_currentFile->m_structIndex.find(struct_offset);
+            if (container != nullptr) {
+                std::cout << "note: location 0x" << std::hex << struct_offset << " lies inside of the struct at 0x" << container->m_offset << std::dec << '\n';
+            }
+            const location struct_member_start = location(m_currentFile->m_bytes) + struct_offset;
+            u32 member_location = 0;
+            for (u32 i = 0; i < member_index; ++i) {
+                member_location += member_size(classify_member(struct_member_start + member_location));
+            }
+            edit_location = struct_member_start + member_location;
+            edit_member_size = member_size(classify_member(edit_location));
         }
-        const u32 edit_member_size = insert_next_struct_member(struct_member_start + member_location, 0);
         if (edit_member_size == 8 && (value.m_editType != EditType::SID_STR && value.m_editType != EditType::SID_HASH && value.m_editType != EditType::PTR)) {
             std::cout << "warning: member " << member_index << " of struct at location 0x" << std::hex << struct_offset
                 << " is size 8, but value passed is of size 4. edit will not be applied.\n";
@@ -61,7 +79,6 @@ namespace dconstruct {
                 << " is size 4, but value passed is of size 8. edit will not be applied.\n";
             return;
         }
-        const location edit_location = struct_member_start + member_location;
         std::cout << "applying change at location 0x" << std::hex << struct_offset << "[0x" << member_index << "]: " << std::dec;
         switch (value.m_editType) {
             case EditType::INT4: {
@@ -80,15 +97,16 @@ namespace dconstruct {
                 break;
             }
             case EditType::SID_STR: {
-                const char* old_sid = lookup(edit_location.get<sid64>());
-                const u64 new_sid = SID(value.string->c_str());
-                if (m_sidbase->search(new_sid) != nullptr) {
+                const std::string old_sid = lookup(edit_location.get<sid64>());
+                sid64 new_sid = 0;
+                if (m_sidbase->find_hash(*value.string, new_sid)) {
                     std::cout << old_sid << "->" << *value.string << '\n';
                     *reinterpret_cast<sid64*>(const_cast<std::byte*>(edit_location.m_ptr)) = new_sid;
                 }
                 else {
-                    std::cout << "warning: the sid '" << value.string << "' does not exist within the sidbase, so the edit will not be applied. " \
-                        "if this is intentional, please use the numerical hash instead (#" << std::hex << std::setfill('0') << std::setw(16) << ").";
+                    std::cout << "warning: the sid '" << *value.string << "' does not exist within the sidbase, so the edit will not be applied. " \
+                        "if this is intentional, please use the numerical hash instead (" << int_to_string_id(SID(value.string->c_str())) << ").\n";
+                    print_sids_with_prefix(*value.string);
                 }
                 break;
             }
@@ -100,14 +118,19 @@ namespace dconstruct {
                 break;
             }
             case EditType::PTR: {
-                std::cout << edit_location.get<u64>() - reinterpret_cast<p64>(m_currentFile->m_bytes.get()) << '=' << value.u64 - reinterpret_cast<p64>(m_currentFile->m_bytes.get()) << '\n';
-                *reinterpret_cast<u64*>(const_cast<std::byte*>(edit_location.m_ptr)) = value.u64;
+                std::cout << m_currentFile->resolve(edit_location.get<p64>()) - reinterpret_cast<p64>(m_currentFile->m_bytes) << '=' << value.u64 - reinterpret_cast<p64>(m_currentFile->m_bytes) << '\n';
+                *reinterpret_cast<u64*>(const_cast<std::byte*>(edit_location.m_ptr)) = m_currentFile->to_stored(value.u64);
                 break;
             }
         }
+        // the new value may have changed how the members of the struct are guessed
+        if (record != nullptr && record->m_numMembers != 0) {
+            reindex_struct(*record);
+        }
     }
 
     void EditDisassembler::apply_file_edits() noexcept {
+        build_struct_index();
         b8 applied_at_least_one = false;
         u16 edit_index = 0;
         for (const auto& edit_str : m_edits) {
@@ -141,12 +164,34 @@ namespace dconstruct {
         }
     }
 
+    void EditDisassembler::print_sids_with_prefix(const std::string& prefix) const {
+        constexpr u32 max_printed = 8;
+        u32 num_found = 0;
+        m_sidbase->for_each_with_prefix(prefix, [&](const sid64, const char* str) {
+            if (num_found++ < max_printed) {
+                std::cout << (num_found == 1 ? "sids starting with '" + prefix + "': " : ", ") << str;
+            }
+        });
+        if (num_found > max_printed) {
+            std::cout << " and " << num_found - max_printed << " more";
+        }
+        if (num_found != 0) {
+            std::cout << '\n';
+        }
+    }
+
     void EditDisassembler::complete() {
         const std::filesystem::path edited_file_path = m_currentFile->m_path.parent_path() / (m_currentFile->m_path.stem().string() + "_edited.bin");
         std::cout << "creating edited file: " << edited_file_path << '\n';
-        std::unique_ptr<std::byte[]> unmapped_bytes = m_currentFile->get_unmapped();
         FILE *out = fopen(edited_file_path.string().c_str(), "wb");
-        fwrite(unmapped_bytes.get(), sizeof(unmapped_bytes[0]), m_currentFile->m_size, out);
+        if (m_currentFile->m_decodeMode == DecodeMode::OFFSETS) {
+            // the image was never relocated, so it can be written out as is
+            fwrite(m_currentFile->m_bytes, sizeof(std::byte), m_currentFile->m_size, out);
+        } else {
+            std::unique_ptr<std::byte[]> unmapped_bytes = m_currentFile->get_unmapped();
+            fwrite(unmapped_bytes.get(), sizeof(unmapped_bytes[0]), m_currentFile->m_size, out);
+        }
+        fclose(out);
     }
 }
 
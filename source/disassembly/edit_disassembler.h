@@ -39,6 +39,9 @@ namespace dconstruct {
     private:
         std::vector<std::string> m_edits;
 
+        // lists a few sids that start with prefix, in case prefix was only the start of the name
+        void print_sids_with_prefix(const std::string& prefix) const;
+
         void insert_span(const char* text, const u32 indent = 0, const TextFormat& text_format = TextFormat{}) override {};
         void complete() override;
     };
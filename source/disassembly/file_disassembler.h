@@ -1,35 +1,149 @@
 #include "disassembler.h"
-#include <fstream>
+#include "ir_file.h"
+#include "output_stream.h"
+#include <bit>
+#include <cstring>
+#include <iostream>
+#include <memory>
 
 
 namespace dconstruct {
     class FileDisassembler : public Disassembler {
 
     public:
-        FileDisassembler(BinaryFile* file, const SIDBase* sidbase, const std::string& out_file, const DisassemblerOptions& options) {
+        // with an ir_file, the tables of the listing are written there as well
+        FileDisassembler(BinaryFile* file, const SIDBase* sidbase, const std::string& out_file, const DisassemblerOptions& options, const std::string& ir_file = {}) {
             m_currentFile = file;
             m_sidbase = sidbase;
-            m_outbuf.reserve(0x2FFFFFULL);
-            m_outfptr = fopen(out_file.c_str(), "wb");
+            (void)m_out.open(out_file, options.m_output);
+            m_textOutput = &m_out;
             m_options = options;
+            if (!ir_file.empty()) {
+                m_ir = std::make_unique<IrBuilder>();
+                m_irPath = ir_file;
+            }
         }
 
     private:
-        std::string m_outbuf;
-        FILE* m_outfptr;
+        OutputStream m_out;
+        std::unique_ptr<IrBuilder> m_ir;
+        std::string m_irPath;
+        sid64 m_mapKey = 0;
 
         void insert_span(const char* text, const u32 indent = 0, const TextFormat& text_format = TextFormat{}) override {
-            if (indent > 0) {
-                m_outbuf += std::string(indent, ' ');
-                //printf("%*s", (i32)indent, "");
-            }
-            m_outbuf += text;
+            append_padding(m_out, ' ', indent);
+            m_out.append(text, std::strlen(text));
             //printf("%s", text);
         }
 
         void complete() override {
-            fwrite(m_outbuf.c_str(), sizeof(char), m_outbuf.length(), m_outfptr);
-            fclose(m_outfptr);
+            if (!m_out.close()) {
+                std::cout << "error: couldn't write the listing of " << m_currentFile->m_path << '\n';
+            }
+            if (m_ir != nullptr && !m_ir->write(m_irPath, *m_sidbase)) {
+                std::cout << "error: couldn't write " << m_irPath << '\n';
+            }
+        }
+
+        void begin_entry(const u32 index, const Entry* entry) override {
+            if (m_ir != nullptr) {
+                m_ir->add_entry(entry->m_nameID, entry->m_typeId);
+            }
+        }
+
+        void insert_map_key(const sid64 key) override {
+            m_mapKey = key;
+        }
+
+        void begin_struct(const u32 offset, const sid64 type_id) override {
+            if (m_ir != nullptr) {
+                m_ir->begin_struct(offset, type_id, m_mapKey);
+            }
+            m_mapKey = 0;
+        }
+
+        void end_struct() override {
+            if (m_ir != nullptr) {
+                m_ir->end_struct();
+            }
+        }
+
+        void insert_value(const location member, const MemberKind kind) override {
+            if (m_ir == nullptr) {
+                return;
+            }
+            switch (kind) {
+                case MemberKind::POINTER: {
+                    const location target = m_currentFile->deref(member);
+                    if (m_currentFile->is_string(target)) {
+                        m_ir->add_member(get_offset(member), IrValueKind::STRING, m_ir->add_string(printable(target.as<char>())));
+                    } else {
+                        m_ir->add_member(get_offset(member), IrValueKind::POINTER, get_offset(target));
+                    }
+                    break;
+                }
+                case MemberKind::STRING: {
+                    m_ir->add_member(get_offset(member), IrValueKind::STRING, m_ir->add_string(printable(member.as<char>())));
+                    break;
+                }
+                case MemberKind::RAW_STRING: {
+                    const char* str = member.get<char*>();
+                    m_ir->add_member(get_offset(member), IrValueKind::STRING, str != nullptr ? m_ir->add_string(printable(str)) : IR_NONE);
+                    break;
+                }
+                case MemberKind::SID: {
+                    m_ir->add_member(get_offset(member), IrValueKind::SID, member.get<sid64>());
+                    break;
+                }
+                case MemberKind::FLOAT: {
+                    m_ir->add_member(get_offset(member), IrValueKind::FLOAT, std::bit_cast<u64>(static_cast<f64>(member.get<f32>())));
+                    break;
+                }
+                case MemberKind::INT: {
+                    m_ir->add_member(get_offset(member), IrValueKind::INT, static_cast<u64>(static_cast<i64>(member.get<i32>())));
+                    break;
+                }
+            }
+        }
+
+        void insert_function(const ScriptLambda* lambda, const FunctionDisassembly& function) override {
+            if (m_ir == nullptr) {
+                return;
+            }
+            m_ir->add_function(get_offset(lambda), get_offset(m_currentFile->resolve(lambda->m_pOpcode)), get_offset(function.m_stackFrame.m_symbolTable), function);
+            for (const auto& [index, entry] : function.m_stackFrame.symbolTableEntries) {
+                switch (entry.m_type) {
+                    case SymbolTableEntryType::FLOAT: {
+                        m_ir->add_symbol(index, IrValueKind::FLOAT, std::bit_cast<u64>(static_cast<f64>(entry.m_f32)));
+                        break;
+                    }
+                    case SymbolTableEntryType::INT: {
+                        m_ir->add_symbol(index, IrValueKind::INT, static_cast<u64>(entry.m_i64));
+                        break;
+                    }
+                    case SymbolTableEntryType::STRING: {
+                        m_ir->add_symbol(index, IrValueKind::STRING, m_ir->add_string(printable(reinterpret_cast<const char*>(entry.m_pointer))));
+                        break;
+                    }
+                    case SymbolTableEntryType::POINTER: {
+                        // pointers into the file are stored as offsets, everything else in these slots is a hash
+                        if (m_currentFile->contains(entry.m_pointer)) {
+                            m_ir->add_symbol(index, IrValueKind::POINTER, get_offset(reinterpret_cast<const void*>(entry.m_pointer)));
+                        } else {
+                            m_ir->add_symbol(index, IrValueKind::SID, entry.m_pointer);
+                        }
+                        break;
+                    }
+                    case SymbolTableEntryType::STRINGID_64: {
+                        m_ir->add_symbol(index, IrValueKind::SID, entry.m_hash);
+                        break;
+                    }
+                    default: {
+                        m_ir->add_symbol(index, IrValueKind::NONE, static_cast<u64>(entry.m_i64));
+                        break;
+                    }
+                }
+            }
         }
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,351 @@
+#pragma once
+
+#include "base.h"
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+namespace dconstruct {
+    /*
+        printf style formatting that writes straight into the output. the format string is parsed and checked against
+        the types of the arguments at compile time, numbers are converted with std::to_chars and padding is copied from
+        a slab, so formatting a span neither allocates nor goes through a temporary buffer.
+        only the part of printf that the disassembler uses is supported: %d %i %u %x %X %f %s and %%, the - and 0 flags,
+        widths and precisions (also given as *), and the l and ll length modifiers. the text is the same printf writes.
+    */
+    enum class FormatArgKind : u8 {
+        INT,
+        FLOAT,
+        STRING,
+    };
+
+    struct FormatPiece {
+        char m_conversion = 0;  // 0 for literal text
+        b8 m_leftAlign = false;
+        b8 m_zeroPad = false;
+        b8 m_long = false;
+        u16 m_offset = 0;       // literal text only, where it starts in the format string and its length
+        u16 m_length = 0;
+        i16 m_width = 0;
+        i16 m_precision = -1;   // -1 if there is none
+        i8 m_widthArg = -1;     // the argument with the width or precision for a *
+        i8 m_precisionArg = -1;
+        u8 m_arg = 0;
+    };
+
+    static constexpr u64 MAX_FORMAT_PIECES = 32;
+    static constexpr u64 PADDING_SLAB_SIZE = 128;
+
+    inline constexpr std::array<char, PADDING_SLAB_SIZE> SPACE_SLAB = [] {
+        std::array<char, PADDING_SLAB_SIZE> slab{};
+        slab.fill(' ');
+        return slab;
+    }();
+
+    inline constexpr std::array<char, PADDING_SLAB_SIZE> ZERO_SLAB = [] {
+        std::array<char, PADDING_SLAB_SIZE> slab{};
+        slab.fill('0');
+        return slab;
+    }();
+
+    // not constexpr, so calling it while parsing a format string at compile time fails the build
+    inline void invalid_format_string(const char*) {}
+
+    template<typename T>
+    [[nodiscard]] consteval FormatArgKind format_arg_kind() {
+        using U = std::remove_cvref_t<T>;
+        if constexpr (std::is_integral_v<U> || std::is_enum_v<U>) {
+            return FormatArgKind::INT;
+        } else if constexpr (std::is_floating_point_v<U>) {
+            return FormatArgKind::FLOAT;
+        } else {
+            static_assert(std::is_convertible_v<U, const char*>, "format arguments have to be numbers or strings");
+            return FormatArgKind::STRING;
+        }
+    }
+
+    template<typename... Args>
+    class FormatString {
+    public:
+        consteval FormatString(const char* format) : m_format(format) {
+            constexpr std::array<FormatArgKind, sizeof...(Args)> kinds{ format_arg_kind<Args>()... };
+            u64 next_arg = 0;
+            const auto take_arg = [&](const FormatArgKind kind) -> u8 {
+                if (next_arg >= kinds.size()) {
+                    invalid_format_string("more conversions than arguments");
+                }
+                if (kinds[next_arg] != kind) {
+                    invalid_format_string("argument doesn't match its conversion");
+                }
+                return static_cast<u8>(next_arg++);
+            };
+            const auto add_piece = [&](const FormatPiece& piece) {
+                if (m_numPieces == MAX_FORMAT_PIECES) {
+                    invalid_format_string("too many pieces");
+                }
+                m_pieces[m_numPieces++] = piece;
+            };
+            const auto read_number = [&](u64& pos) -> i16 {
+                i16 number = 0;
+                while (format[pos] >= '0' && format[pos] <= '9') {
+                    number = number * 10 + (format[pos++] - '0');
+                }
+                return number;
+            };
+
+            u64 pos = 0;
+            while (format[pos] != '\0') {
+                if (format[pos] == '%' && format[pos + 1] == '%') {
+                    add_piece(FormatPiece{ .m_offset = static_cast<u16>(pos + 1), .m_length = 1 });
+                    pos += 2;
+                    continue;
+                }
+                if (format[pos] != '%') {
+                    const u64 start = pos;
+                    while (format[pos] != '\0' && format[pos] != '%') {
+                        ++pos;
+                    }
+                    add_piece(FormatPiece{ .m_offset = static_cast<u16>(start), .m_length = static_cast<u16>(pos - start) });
+                    continue;
+                }
+
+                FormatPiece piece{};
+                ++pos;
+                for (;; ++pos) {
+                    if (format[pos] == '-') {
+                        piece.m_leftAlign = true;
+                    } else if (format[pos] == '0') {
+                        piece.m_zeroPad = true;
+                    } else {
+                        break;
+                    }
+                }
+                if (format[pos] == '*') {
+                    ++pos;
+                    piece.m_widthArg = take_arg(FormatArgKind::INT);
+                } else {
+                    piece.m_width = read_number(pos);
+                }
+                if (format[pos] == '.') {
+                    ++pos;
+                    if (format[pos] == '*') {
+                        ++pos;
+                        piece.m_precisionArg = take_arg(FormatArgKind::INT);
+                    } else {
+                        piece.m_precision = read_number(pos);
+                    }
+                }
+                if (format[pos] == 'l') {
+                    piece.m_long = true;
+                    pos += format[pos + 1] == 'l' ? 2 : 1;
+                }
+
+                piece.m_conversion = format[pos];
+                switch (piece.m_conversion) {
+                    case 'd':
+                    case 'i':
+                    case 'u':
+                    case 'x':
+                    case 'X': {
+                        if (piece.m_precision != -1 || piece.m_precisionArg != -1) {
+                            invalid_format_string("integer conversions don't take a precision");
+                        }
+                        piece.m_arg = take_arg(FormatArgKind::INT);
+                        break;
+                    }
+                    case 'f': {
+                        if (piece.m_precision == -1 && piece.m_precisionArg == -1) {
+                            piece.m_precision = 6;
+                        }
+                        piece.m_arg = take_arg(FormatArgKind::FLOAT);
+                        break;
+                    }
+                    case 's': {
+                        piece.m_arg = take_arg(FormatArgKind::STRING);
+                        break;
+                    }
+                    default: {
+                        invalid_format_string("unsupported conversion");
+                    }
+                }
+                ++pos;
+                add_piece(piece);
+            }
+            if (next_arg != kinds.size()) {
+                invalid_format_string("more arguments than conversions");
+            }
+        }
+
+        const char* m_format;
+        std::array<FormatPiece, MAX_FORMAT_PIECES> m_pieces{};
+        u64 m_numPieces = 0;
+    };
+
+    // an argument with its type erased. integers keep all of their bits, the conversion decides how many are used.
+    struct FormatArg {
+        union {
+            u64 m_int;
+            f64 m_float;
+            const char* m_string;
+        };
+
+        template<typename T>
+        FormatArg(const T value) noexcept {
+            if constexpr (std::is_enum_v<T>) {
+                m_int = static_cast<u64>(static_cast<std::underlying_type_t<T>>(value));
+            } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+                m_int = static_cast<u64>(static_cast<i64>(value));
+            } else if constexpr (std::is_integral_v<T>) {
+                m_int = static_cast<u64>(value);
+            } else if constexpr (std::is_floating_point_v<T>) {
+                m_float = static_cast<f64>(value);
+            } else {
+                m_string = value;
+            }
+        }
+    };
+
+    // fixed size buffer for spans that still have to be handed over as a whole
+    template<u64 size>
+    struct FormatBuffer {
+        char m_data[size];
+        u64 m_size = 0;
+
+        void append(const char* text, const u64 length) noexcept {
+            std::memcpy(m_data + m_size, text, length);
+            m_size += length;
+        }
+
+        [[nodiscard]] const char* c_str() noexcept {
+            m_data[m_size] = '\0';
+            return m_data;
+        }
+    };
+
+    template<typename Output>
+    void append_padding(Output& out, const char c, u64 count) {
+        const char* slab = c == '0' ? ZERO_SLAB.data() : SPACE_SLAB.data();
+        while (count > 0) {
+            const u64 chunk = count < PADDING_SLAB_SIZE ? count : PADDING_SLAB_SIZE;
+            out.append(slab, chunk);
+            count -= chunk;
+        }
+    }
+
+    // appends to out, and drops everything past limit
+    template<typename Output>
+    class FormatWriter {
+    public:
+        FormatWriter(Output& out, const u64 limit) noexcept : m_out(out), m_remaining(limit) {}
+
+        void write(const char* text, u64 length) {
+            length = length < m_remaining ? length : m_remaining;
+            m_out.append(text, length);
+            m_remaining -= length;
+        }
+
+        void pad(const char c, u64 count) {
+            count = count < m_remaining ? count : m_remaining;
+            append_padding(m_out, c, count);
+            m_remaining -= count;
+        }
+
+        // writes text of length as a field of width. prefix_length characters of text (a sign) go before zero padding.
+        void write_field(const char* text, const u64 length, const u64 prefix_length, const u64 width, const b8 left_align, const b8 zero_pad) {
+            const u64 padding = width > length ? width - length : 0;
+            if (left_align) {
+                write(text, length);
+                pad(' ', padding);
+            } else if (zero_pad) {
+                write(text, prefix_length);
+                pad('0', padding);
+                write(text + prefix_length, length - prefix_length);
+            } else {
+                pad(' ', padding);
+                write(text, length);
+            }
+        }
+
+    private:
+        Output& m_out;
+        u64 m_remaining;
+    };
+
+    template<typename Output>
+    void format_piece(FormatWriter<Output>& out, const char* format, const FormatPiece& piece, const FormatArg* args) {
+        if (piece.m_conversion == 0) {
+            out.write(format + piece.m_offset, piece.m_length);
+            return;
+        }
+
+        b8 left_align = piece.m_leftAlign;
+        i64 width = piece.m_width;
+        if (piece.m_widthArg != -1) {
+            width = static_cast<i32>(args[piece.m_widthArg].m_int);
+            // a negative width from an argument is a - flag
+            if (width < 0) {
+                left_align = true;
+                width = -width;
+            }
+        }
+        i64 precision = piece.m_precision;
+        if (piece.m_precisionArg != -1) {
+            precision = static_cast<i32>(args[piece.m_precisionArg].m_int);
+        }
+        const FormatArg& arg = args[piece.m_arg];
+
+        switch (piece.m_conversion) {
+            case 's': {
+                const char* str = arg.m_string != nullptr ? arg.m_string : "(null)";
+                const u64 length = precision >= 0 ? strnlen(str, precision) : std::strlen(str);
+                out.write_field(str, length, 0, width, left_align, false);
+                break;
+            }
+            case 'd':
+            case 'i': {
+                const i64 value = piece.m_long ? static_cast<i64>(arg.m_int) : static_cast<i32>(arg.m_int);
+                char digits[24];
+                const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+                out.write_field(digits, result.ptr - digits, value < 0 ? 1 : 0, width, left_align, piece.m_zeroPad);
+                break;
+            }
+            case 'u':
+            case 'x':
+            case 'X': {
+                const u64 value = piece.m_long ? arg.m_int : static_cast<u32>(arg.m_int);
+                char digits[24];
+                const auto result = std::to_chars(digits, digits + sizeof(digits), value, piece.m_conversion == 'u' ? 10 : 16);
+                if (piece.m_conversion == 'X') {
+                    for (char* c = digits; c < result.ptr; ++c) {
+                        *c = *c >= 'a' ? *c - 'a' + 'A' : *c;
+                    }
+                }
+                out.write_field(digits, result.ptr - digits, 0, width, left_align, piece.m_zeroPad);
+                break;
+            }
+            case 'f': {
+                // the longest double is 309 digits before the point
+                char digits[384];
+                const auto result = std::to_chars(digits, digits + sizeof(digits), arg.m_float, std::chars_format::fixed, precision < 0 ? 6 : precision);
+                const u64 length = result.ec == std::errc{} ? result.ptr - digits : 0;
+                // printf never pads inf and nan with zeros
+                const b8 zero_pad = piece.m_zeroPad && std::isfinite(arg.m_float);
+                out.write_field(digits, length, std::signbit(arg.m_float) ? 1 : 0, width, left_align, zero_pad);
+                break;
+            }
+        }
+    }
+
+    // formats args into out the way snprintf would into a buffer of limit + 1 bytes
+    template<typename Output, typename... Args>
+    void format_to(Output& out, const u64 limit, const FormatString<std::type_identity_t<Args>...>& format, const Args... args) {
+        const FormatArg erased_args[sizeof...(Args) + 1] = { FormatArg(args)..., FormatArg(0) };
+        FormatWriter<Output> writer(out, limit);
+        for (u64 i = 0; i < format.m_numPieces; ++i) {
+            format_piece(writer, format.m_format, format.m_pieces[i], erased_args);
+        }
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "base.h"
+#include <bit>
+#include <cstring>
+
+namespace dconstruct {
+    // xxh64. only used to key caches on file contents, so it doesn't need to be cryptographically secure.
+    [[nodiscard]] inline u64 hash_bytes(const void* data, const u64 size, const u64 seed = 0) noexcept {
+        constexpr u64 P1 = 11400714785074694791ULL;
+        constexpr u64 P2 = 14029467366897019727ULL;
+        constexpr u64 P3 = 1609587929392839161ULL;
+        constexpr u64 P4 = 9650029242287828579ULL;
+        constexpr u64 P5 = 2870177450012600261ULL;
+
+        const u8* ptr = reinterpret_cast<const u8*>(data);
+        const u8* const end = ptr + size;
+
+        const auto read64 = [](const u8* p) noexcept { u64 v; std::memcpy(&v, p, sizeof(v)); return v; };
+        const auto read32 = [](const u8* p) noexcept { u32 v; std::memcpy(&v, p, sizeof(v)); return v; };
+        const auto round = [](u64 acc, const u64 input) noexcept { acc += input * P2; return std::rotl(acc, 31) * P1; };
+        const auto merge = [&round](u64 acc, const u64 val) noexcept { acc ^= round(0, val); return acc * P1 + P4; };
+
+        u64 hash;
+        if (size >= 32) {
+            u64 v1 = seed + P1 + P2;
+            u64 v2 = seed + P2;
+            u64 v3 = seed;
+            u64 v4 = seed - P1;
+            do {
+                v1 = round(v1, read64(ptr));
+                v2 = round(v2, read64(ptr + 8));
+                v3 = round(v3, read64(ptr + 16));
+                v4 = round(v4, read64(ptr + 24));
+                ptr += 32;
+            } while (end - ptr >= 32);
+            hash = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+            hash = merge(hash, v1);
+            hash = merge(hash, v2);
+            hash = merge(hash, v3);
+            hash = merge(hash, v4);
+        } else {
+            hash = seed + P5;
+        }
+        hash += size;
+
+        for (; end - ptr >= 8; ptr += 8) {
+            hash ^= round(0, read64(ptr));
+            hash = std::rotl(hash, 27) * P1 + P4;
+        }
+        if (end - ptr >= 4) {
+            hash ^= static_cast<u64>(read32(ptr)) * P1;
+            hash = std::rotl(hash, 23) * P2 + P3;
+            ptr += 4;
+        }
+        for (; ptr < end; ++ptr) {
+            hash ^= *ptr * P5;
+            hash = std::rotl(hash, 11) * P1;
+        }
+
+        hash ^= hash >> 33;
+        hash *= P2;
+        hash ^= hash >> 29;
+        hash *= P3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+
+    // murmur3's 64 bit finalizer. a bijection, so distinct inputs never collide.
+    [[nodiscard]] constexpr u64 mix64(u64 x) noexcept {
+        x ^= x >> 33;
+        x *= 0xFF51AFD7ED558CCDULL;
+        x ^= x >> 33;
+        x *= 0xC4CEB9FE1A85EC53ULL;
+        x ^= x >> 33;
+        return x;
+    }
+}
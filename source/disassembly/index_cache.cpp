@@ -0,0 +1,182 @@
+#include "index_cache.h"
+#include "instructions.h"
+
+#include <algorithm>
+#include <fstream>
+#include <type_traits>
+#include <vector>
+
+namespace dconstruct {
+    static constexpr u32 INDEX_CACHE_MAGIC = 0x58494344; // "DCIX"
+    static constexpr u32 INDEX_CACHE_VERSION = 3;
+
+    static_assert(std::is_trivially_copyable_v<StructRecord> && alignof(StructRecord) <= 8);
+    static_assert(std::is_trivially_copyable_v<StructMember> && alignof(StructMember) <= 8);
+    static_assert(std::is_trivially_copyable_v<FunctionRecord> && alignof(FunctionRecord) <= 8);
+    static_assert(std::is_trivially_copyable_v<ResolvedSid> && alignof(ResolvedSid) <= 8);
+
+    [[nodiscard]] static u64 align_up(const u64 value) noexcept {
+        return (value + 7) & ~u64{7};
+    }
+
+    template<typename T>
+    [[nodiscard]] static b8 get_table(const MappedFile& mapping, const u64 offset, const u64 count, std::span<const T>& table) noexcept {
+        if (offset % 8 != 0 || offset > mapping.size() || count > (mapping.size() - offset) / sizeof(T)) {
+            return false;
+        }
+        table = { reinterpret_cast<const T*>(mapping.data() + offset), count };
+        return true;
+    }
+
+    [[nodiscard]] std::filesystem::path index_cache_path(const std::filesystem::path& file_path) {
+        std::filesystem::path path = file_path;
+        path += ".dcidx";
+        return path;
+    }
+
+    // the disassembler reads the file at the offsets of the structs and members without checking them again,
+    // and at() and find() binary search the structs, so they have to be sorted
+    [[nodiscard]] static b8 valid_structs(const std::span<const StructRecord> structs, const std::span<const StructMember> members, const u64 file_size) noexcept {
+        for (u64 i = 0; i < structs.size(); ++i) {
+            const StructRecord& record = structs[i];
+            if ((i > 0 && structs[i - 1].m_offset >= record.m_offset) || record.m_offset > file_size || record.m_size > file_size - record.m_offset ||
+                (record.m_parent != StructIndex::NO_PARENT && record.m_parent >= structs.size()) ||
+                record.m_firstMember > members.size() || record.m_numMembers > members.size() - record.m_firstMember) {
+                return false;
+            }
+        }
+        for (const StructMember& member : members) {
+            if (member.m_kind > MemberKind::INT || member.m_offset > file_size || member_size(member.m_kind) > file_size - member.m_offset) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // the code of every lambda has to lie in front of its symbol table inside of the file, and the records sorted by offset
+    [[nodiscard]] static b8 valid_functions(const std::span<const FunctionRecord> functions, const u64 file_size) noexcept {
+        for (u64 i = 0; i < functions.size(); ++i) {
+            const FunctionRecord& record = functions[i];
+            if ((i > 0 && functions[i - 1].m_offset >= record.m_offset) || record.m_offset >= file_size ||
+                record.m_codeOffset > record.m_symbolTableOffset || record.m_symbolTableOffset > file_size ||
+                record.m_numInstructions > (record.m_symbolTableOffset - record.m_codeOffset) / sizeof(Instruction) ||
+                record.m_numArgs > record.m_numInstructions) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // resolved_sid() binary searches the sids, and their strings are read straight from the stored offsets
+    [[nodiscard]] static b8 valid_sids(const std::span<const ResolvedSid> sids, const SIDBase& sidbase) noexcept {
+        for (u64 i = 0; i < sids.size(); ++i) {
+            if ((i > 0 && sids[i - 1].m_sid >= sids[i].m_sid) ||
+                (sids[i].m_sidbaseOffset != ResolvedSid::NOT_FOUND && !sidbase.is_valid_offset(sids[i].m_sidbaseOffset))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    [[nodiscard]] b8 load_index_cache(const std::filesystem::path& path, const IndexCacheKey& key, const u64 file_size, const SIDBase& sidbase, StructIndex& index) noexcept {
+        MappedFile mapping;
+        if (!mapping.open(path, MapAccess::READ_ONLY) || mapping.size() < sizeof(IndexCacheHeader)) {
+            return false;
+        }
+
+        const IndexCacheHeader* header = reinterpret_cast<const IndexCacheHeader*>(mapping.data());
+        if (header->m_magic != INDEX_CACHE_MAGIC || header->m_version != INDEX_CACHE_VERSION) {
+            return false;
+        }
+        if (header->m_key.m_contentHash != key.m_contentHash || header->m_key.m_sidbaseId != key.m_sidbaseId) {
+            return false;
+        }
+
+        std::span<const StructRecord> structs;
+        std::span<const StructMember> members;
+        std::span<const FunctionRecord> functions;
+        std::span<const ResolvedSid> sids;
+        if (!get_table(mapping, header->m_structsOffset, header->m_numStructs, structs) ||
+            !get_table(mapping, header->m_membersOffset, header->m_numMembers, members) ||
+            !get_table(mapping, header->m_functionsOffset, header->m_numFunctions, functions) ||
+            !get_table(mapping, header->m_sidsOffset, header->m_numSids, sids)) {
+            return false;
+        }
+        if (!valid_structs(structs, members, file_size) || !valid_functions(functions, file_size) || !valid_sids(sids, sidbase)) {
+            return false;
+        }
+
+        index.adopt(std::move(mapping), structs, members, functions, sids);
+        return true;
+    }
+
+    [[nodiscard]] b8 save_index_cache(const std::filesystem::path& path, const IndexCacheKey& key, const StructIndex& index, const SIDBase& sidbase) noexcept {
+        // the sids the pre-pass already resolved, plus the ones that were only looked up while printing
+        std::vector<ResolvedSid> sids(index.resolved_sids().begin(), index.resolved_sids().end());
+        for (const sid64 sid : index.used_sids()) {
+            const char* str = sidbase.search(sid);
+            if (str == nullptr) {
+                sids.push_back(ResolvedSid{ sid, ResolvedSid::NOT_FOUND });
+                continue;
+            }
+            // a string without an offset is left out, so the next run searches for it again
+            const u64 offset = sidbase.offset_of(str);
+            if (offset != SID_NO_OFFSET) {
+                sids.push_back(ResolvedSid{ sid, offset });
+            }
+        }
+        std::sort(sids.begin(), sids.end(), [](const ResolvedSid& lhs, const ResolvedSid& rhs) {
+            return lhs.m_sid < rhs.m_sid;
+        });
+        sids.erase(std::unique(sids.begin(), sids.end(), [](const ResolvedSid& lhs, const ResolvedSid& rhs) {
+            return lhs.m_sid == rhs.m_sid;
+        }), sids.end());
+
+        IndexCacheHeader header{};
+        header.m_magic = INDEX_CACHE_MAGIC;
+        header.m_version = INDEX_CACHE_VERSION;
+        header.m_key = key;
+        header.m_numStructs = index.structs().size();
+        header.m_numMembers = index.all_members().size();
+        header.m_numFunctions = index.functions().size();
+        header.m_numSids = sids.size();
+        header.m_structsOffset = align_up(sizeof(IndexCacheHeader));
+        header.m_membersOffset = align_up(header.m_structsOffset + header.m_numStructs * sizeof(StructRecord));
+        header.m_functionsOffset = align_up(header.m_membersOffset + header.m_numMembers * sizeof(StructMember));
+        header.m_sidsOffset = align_up(header.m_functionsOffset + header.m_numFunctions * sizeof(FunctionRecord));
+
+        // written under a temporary name first, so nobody ever maps a half written sidecar
+        std::filesystem::path temp_path = path;
+        temp_path += ".tmp";
+        {
+            std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+            if (!out.is_open()) {
+                return false;
+            }
+            const auto write_table = [&out](const u64 offset, const void* data, const u64 size) {
+                constexpr char padding[8] = {};
+                out.write(padding, offset - out.tellp());
+                out.write(reinterpret_cast<const char*>(data), size);
+            };
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            write_table(header.m_structsOffset, index.structs().data(), index.structs().size_bytes());
+            write_table(header.m_membersOffset, index.all_members().data(), index.all_members().size_bytes());
+            write_table(header.m_functionsOffset, index.functions().data(), index.functions().size_bytes());
+            write_table(header.m_sidsOffset, sids.data(), sids.size() * sizeof(ResolvedSid));
+            if (!out.good()) {
+                out.close();
+                std::error_code ec;
+                std::filesystem::remove(temp_path, ec);
+                return false;
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(temp_path, path, ec);
+        if (ec) {
+            std::filesystem::remove(temp_path, ec);
+            return false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "base.h"
+#include "struct_index.h"
+#include "sidbase.h"
+#include <filesystem>
+
+namespace dconstruct {
+    // a sidecar belongs to exactly one version of a file, analyzed against exactly one sidbase
+    struct IndexCacheKey {
+        u64 m_contentHash;
+        u64 m_sidbaseId;
+    };
+
+    /*
+        layout of a .dcidx file. every table starts at an 8 byte aligned offset from the start of the file,
+        so they can be used straight out of the mapping.
+
+        IndexCacheHeader
+        StructRecord[m_numStructs]
+        StructMember[m_numMembers]
+        FunctionRecord[m_numFunctions]
+        ResolvedSid[m_numSids]
+    */
+    struct IndexCacheHeader {
+        u32 m_magic;
+        u32 m_version;
+        IndexCacheKey m_key;
+        u64 m_structsOffset;
+        u64 m_numStructs;
+        u64 m_membersOffset;
+        u64 m_numMembers;
+        u64 m_functionsOffset;
+        u64 m_numFunctions;
+        u64 m_sidsOffset;
+        u64 m_numSids;
+    };
+
+    [[nodiscard]] std::filesystem::path index_cache_path(const std::filesystem::path& file_path);
+
+    // maps the sidecar at path into index if it exists, matches key and all of its offsets fit a file of file_size bytes and sidbase.
+    // a sidecar that fails any check is ignored and rebuilt.
+    [[nodiscard]] b8 load_index_cache(const std::filesystem::path& path, const IndexCacheKey& key, const u64 file_size, const SIDBase& sidbase, StructIndex& index) noexcept;
+    // writes index (and the results of the sids it recorded) to path
+    [[nodiscard]] b8 save_index_cache(const std::filesystem::path& path, const IndexCacheKey& key, const StructIndex& index, const SIDBase& sidbase) noexcept;
+}
@@ -0,0 +1,248 @@
+#include "ir_file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace dconstruct {
+    static constexpr u32 IR_MAGIC = 0x52494344; // "DCIR"
+    static constexpr u32 IR_VERSION = 1;
+
+    [[nodiscard]] static u64 align_up(const u64 value) noexcept {
+        return (value + 7) & ~u64{7};
+    }
+
+    void IrBuilder::add_entry(const sid64 name, const sid64 type) {
+        // the entry's struct is the next one that's added
+        m_entryName.push_back(name);
+        m_entryType.push_back(type);
+        m_entryStruct.push_back(static_cast<u32>(m_structOffset.size()));
+        add_sid(name);
+        add_sid(type);
+    }
+
+    void IrBuilder::begin_struct(const u32 offset, const sid64 type, const sid64 key) {
+        m_scopes.push_back(static_cast<u32>(m_structOffset.size()));
+        m_structOffset.push_back(offset);
+        m_structType.push_back(type);
+        m_structKey.push_back(key);
+        m_structParent.push_back(m_scopes.size() > 1 ? m_scopes[m_scopes.size() - 2] : IR_NONE);
+        if (type != 0) {
+            add_sid(type);
+        }
+        if (key != 0) {
+            add_sid(key);
+        }
+    }
+
+    void IrBuilder::end_struct() {
+        if (!m_scopes.empty()) {
+            m_scopes.pop_back();
+        }
+    }
+
+    void IrBuilder::add_member(const u32 offset, const IrValueKind kind, const u64 value) {
+        if (m_scopes.empty()) {
+            return;
+        }
+        m_memberStruct.push_back(m_scopes.back());
+        m_memberOffset.push_back(offset);
+        m_memberKind.push_back(kind);
+        m_memberValue.push_back(value);
+        if (kind == IrValueKind::SID) {
+            add_sid(value);
+        }
+    }
+
+    void IrBuilder::add_function(const u32 offset, const u32 code, const u32 symbol_table, const FunctionDisassembly& function) {
+        m_functionOffset.push_back(offset);
+        m_functionName.push_back(add_string(function.m_id.c_str()));
+        m_functionStruct.push_back(m_scopes.empty() ? IR_NONE : m_scopes.back());
+        m_functionCode.push_back(code);
+        m_functionArgs.push_back(function.m_stackFrame.m_argCount);
+        m_functionSymbolTable.push_back(symbol_table);
+
+        m_functionFirstInstruction.push_back(static_cast<u32>(m_instructionOpcode.size()));
+        m_functionNumInstructions.push_back(static_cast<u32>(function.m_lines.size()));
+        for (const FunctionDisassemblyLine& line : function.m_lines) {
+            m_instructionOpcode.push_back(static_cast<u8>(line.m_instruction.opcode));
+            m_instructionDestination.push_back(line.m_instruction.destination);
+            m_instructionOperand1.push_back(line.m_instruction.operand1);
+            m_instructionOperand2.push_back(line.m_instruction.operand2);
+            m_instructionTarget.push_back(static_cast<i32>(line.m_target));
+        }
+
+        m_functionFirstSymbol.push_back(static_cast<u32>(m_symbolIndex.size()));
+        m_functionNumSymbols.push_back(0);
+    }
+
+    void IrBuilder::add_symbol(const u32 index, const IrValueKind kind, const u64 value) {
+        if (m_functionNumSymbols.empty()) {
+            return;
+        }
+        m_symbolIndex.push_back(index);
+        m_symbolKind.push_back(kind);
+        m_symbolValue.push_back(value);
+        ++m_functionNumSymbols.back();
+        if (kind == IrValueKind::SID) {
+            add_sid(value);
+        }
+    }
+
+    [[nodiscard]] u32 IrBuilder::add_string(const char* str) {
+        const auto [iter, inserted] = m_stringOffsets.try_emplace(str, static_cast<u32>(m_strings.size()));
+        if (inserted) {
+            m_strings.insert(m_strings.end(), str, str + iter->first.size() + 1);
+        }
+        return iter->second;
+    }
+
+    [[nodiscard]] b8 IrBuilder::write(const std::filesystem::path& path, const SIDBase& sidbase) {
+        // members were added in listing order, where the members of nested structs come in between.
+        // a counting sort by struct keeps every struct's members in order and makes them consecutive.
+        const u64 num_structs = m_structOffset.size();
+        const u64 num_members = m_memberStruct.size();
+        std::vector<u32> first_member(num_structs + 1, 0);
+        for (const u32 row : m_memberStruct) {
+            ++first_member[row + 1];
+        }
+        for (u64 i = 0; i < num_structs; ++i) {
+            first_member[i + 1] += first_member[i];
+        }
+        std::vector<u32> num_struct_members(num_structs);
+        for (u64 i = 0; i < num_structs; ++i) {
+            num_struct_members[i] = first_member[i + 1] - first_member[i];
+        }
+        std::vector<u32> member_struct(num_members);
+        std::vector<u32> member_offset(num_members);
+        std::vector<IrValueKind> member_kind(num_members);
+        std::vector<u64> member_value(num_members);
+        {
+            std::vector<u32> next(first_member.begin(), first_member.end() - 1);
+            for (u64 i = 0; i < num_members; ++i) {
+                const u32 row = next[m_memberStruct[i]]++;
+                member_struct[row] = m_memberStruct[i];
+                member_offset[row] = m_memberOffset[i];
+                member_kind[row] = m_memberKind[i];
+                member_value[row] = m_memberValue[i];
+            }
+        }
+        first_member.pop_back();
+
+        std::sort(m_sidHash.begin(), m_sidHash.end());
+        m_sidHash.erase(std::unique(m_sidHash.begin(), m_sidHash.end()), m_sidHash.end());
+        std::vector<u32> sid_name(m_sidHash.size());
+        for (u64 i = 0; i < m_sidHash.size(); ++i) {
+            const char* str = sidbase.search(m_sidHash[i]);
+            sid_name[i] = str != nullptr ? add_string(str) : IR_NONE;
+        }
+
+        const void* columns[static_cast<u64>(IrColumn::COUNT)] = {
+            m_entryName.data(), m_entryType.data(), m_entryStruct.data(),
+            m_structOffset.data(), m_structType.data(), m_structKey.data(), m_structParent.data(), first_member.data(), num_struct_members.data(),
+            member_struct.data(), member_offset.data(), member_kind.data(), member_value.data(),
+            m_functionOffset.data(), m_functionName.data(), m_functionStruct.data(), m_functionCode.data(), m_functionArgs.data(),
+            m_functionSymbolTable.data(), m_functionFirstInstruction.data(), m_functionNumInstructions.data(), m_functionFirstSymbol.data(), m_functionNumSymbols.data(),
+            m_instructionOpcode.data(), m_instructionDestination.data(), m_instructionOperand1.data(), m_instructionOperand2.data(), m_instructionTarget.data(),
+            m_symbolIndex.data(), m_symbolKind.data(), m_symbolValue.data(),
+            m_sidHash.data(), sid_name.data(),
+        };
+
+        IrHeader header{};
+        header.m_magic = IR_MAGIC;
+        header.m_version = IR_VERSION;
+        header.m_rows[static_cast<u64>(IrTable::ENTRIES)] = m_entryName.size();
+        header.m_rows[static_cast<u64>(IrTable::STRUCTS)] = num_structs;
+        header.m_rows[static_cast<u64>(IrTable::MEMBERS)] = num_members;
+        header.m_rows[static_cast<u64>(IrTable::FUNCTIONS)] = m_functionOffset.size();
+        header.m_rows[static_cast<u64>(IrTable::INSTRUCTIONS)] = m_instructionOpcode.size();
+        header.m_rows[static_cast<u64>(IrTable::SYMBOLS)] = m_symbolIndex.size();
+        header.m_rows[static_cast<u64>(IrTable::SIDS)] = m_sidHash.size();
+        header.m_rows[static_cast<u64>(IrTable::STRINGS)] = m_strings.size();
+        u64 offset = align_up(sizeof(IrHeader));
+        for (u64 i = 0; i < static_cast<u64>(IrColumn::COUNT); ++i) {
+            header.m_columns[i] = offset;
+            offset = align_up(offset + header.m_rows[static_cast<u64>(IR_COLUMN_LAYOUTS[i].m_table)] * IR_COLUMN_LAYOUTS[i].m_elementSize);
+        }
+        header.m_stringsOffset = offset;
+
+        // written under a temporary name first, so nobody ever maps a half written file
+        std::filesystem::path temp_path = path;
+        temp_path += ".tmp";
+        {
+            std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+            if (!out.is_open()) {
+                return false;
+            }
+            const auto write_table = [&out](const u64 offset, const void* data, const u64 size) {
+                constexpr char padding[8] = {};
+                out.write(padding, offset - out.tellp());
+                out.write(reinterpret_cast<const char*>(data), size);
+            };
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            for (u64 i = 0; i < static_cast<u64>(IrColumn::COUNT); ++i) {
+                write_table(header.m_columns[i], columns[i], header.m_rows[static_cast<u64>(IR_COLUMN_LAYOUTS[i].m_table)] * IR_COLUMN_LAYOUTS[i].m_elementSize);
+            }
+            write_table(header.m_stringsOffset, m_strings.data(), m_strings.size());
+            if (!out.good()) {
+                out.close();
+                std::error_code ec;
+                std::filesystem::remove(temp_path, ec);
+                return false;
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(temp_path, path, ec);
+        if (ec) {
+            std::filesystem::remove(temp_path, ec);
+            return false;
+        }
+        return true;
+    }
+
+    [[nodiscard]] b8 IrFile::open(const std::filesystem::path& path) noexcept {
+        m_header = nullptr;
+        if (!m_mapping.open(path, MapAccess::READ_ONLY) || m_mapping.size() < sizeof(IrHeader)) {
+            return false;
+        }
+        const u64 size = m_mapping.size();
+        const IrHeader* header = reinterpret_cast<const IrHeader*>(m_mapping.data());
+        if (header->m_magic != IR_MAGIC || header->m_version != IR_VERSION) {
+            return false;
+        }
+        for (u64 i = 0; i < static_cast<u64>(IrColumn::COUNT); ++i) {
+            const u64 offset = header->m_columns[i];
+            const u64 rows = header->m_rows[static_cast<u64>(IR_COLUMN_LAYOUTS[i].m_table)];
+            if (offset % 8 != 0 || offset > size || rows > (size - offset) / IR_COLUMN_LAYOUTS[i].m_elementSize) {
+                return false;
+            }
+        }
+        const u64 strings_size = header->m_rows[static_cast<u64>(IrTable::STRINGS)];
+        if (header->m_stringsOffset > size || strings_size > size - header->m_stringsOffset) {
+            return false;
+        }
+        // every string has to end inside of the pool
+        if (strings_size != 0 && m_mapping.data()[header->m_stringsOffset + strings_size - 1] != std::byte{0}) {
+            return false;
+        }
+        m_header = header;
+        return true;
+    }
+
+    [[nodiscard]] const char* IrFile::string_at(const u32 offset) const noexcept {
+        if (offset >= rows(IrTable::STRINGS)) {
+            return nullptr;
+        }
+        return reinterpret_cast<const char*>(m_mapping.data() + m_header->m_stringsOffset + offset);
+    }
+
+    [[nodiscard]] const char* IrFile::sid_name(const sid64 sid) const noexcept {
+        const std::span<const sid64> hashes = column<sid64>(IrColumn::SID_HASH);
+        const auto iter = std::lower_bound(hashes.begin(), hashes.end(), sid);
+        if (iter == hashes.end() || *iter != sid) {
+            return nullptr;
+        }
+        return string_at(column<u32>(IrColumn::SID_NAME)[iter - hashes.begin()]);
+    }
+}
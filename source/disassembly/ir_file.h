@@ -0,0 +1,197 @@
+#pragma once
+
+#include "base.h"
+#include "instructions.h"
+#include "mapped_file.h"
+#include "sidbase.h"
+#include <filesystem>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace dconstruct {
+    /*
+        a .dcir file holds everything a listing shows as plain tables, so tools that analyze a corpus over and over
+        can map it and read the columns they need instead of loading the DC files and running the heuristics again.
+        every column is one array with a row per entry, struct, member, function, instruction or symbol, and starts at
+        an 8 byte aligned offset. strings are null terminated inside of the string pool and referenced by their offset.
+
+        IrHeader
+        columns                     in the order of IrColumn, their rows are counted by the table they belong to
+        char strings[m_rows[STRINGS]]
+
+        a struct's members are consecutive, as are a function's instructions and symbols. sids are sorted, so
+        their names can be found with a binary search. member and symbol values depend on their kind:
+        INT is the sign extended integer, FLOAT the bits of an f64, SID the hash, STRING an offset into the pool,
+        POINTER the offset in the DC file that's pointed at, and NONE the raw bits.
+        strings hold the same text as the listing, so their newlines are replaced no matter how the file was decoded.
+    */
+    enum class IrTable : u8 {
+        ENTRIES,
+        STRUCTS,
+        MEMBERS,
+        FUNCTIONS,
+        INSTRUCTIONS,
+        SYMBOLS,
+        SIDS,
+        STRINGS,
+        COUNT,
+    };
+
+    enum class IrColumn : u8 {
+        ENTRY_NAME,                 // sid64
+        ENTRY_TYPE,                 // sid64
+        ENTRY_STRUCT,               // u32, the row of the entry's struct
+        STRUCT_OFFSET,              // u32
+        STRUCT_TYPE,                // sid64, 0 for the elements of arrays
+        STRUCT_KEY,                 // sid64, the key of the values of maps, 0 otherwise
+        STRUCT_PARENT,              // u32, IR_NONE for the structs of entries
+        STRUCT_FIRST_MEMBER,        // u32
+        STRUCT_NUM_MEMBERS,         // u32
+        MEMBER_STRUCT,              // u32
+        MEMBER_OFFSET,              // u32
+        MEMBER_KIND,                // IrValueKind
+        MEMBER_VALUE,               // u64
+        FUNCTION_OFFSET,            // u32
+        FUNCTION_NAME,              // u32, string
+        FUNCTION_STRUCT,            // u32, the struct it's in, IR_NONE if there is none
+        FUNCTION_CODE,              // u32, offset of the first instruction
+        FUNCTION_ARGS,              // u32
+        FUNCTION_SYMBOL_TABLE,      // u32, offset of the symbol table
+        FUNCTION_FIRST_INSTRUCTION, // u32
+        FUNCTION_NUM_INSTRUCTIONS,  // u32
+        FUNCTION_FIRST_SYMBOL,      // u32
+        FUNCTION_NUM_SYMBOLS,       // u32
+        INSTRUCTION_OPCODE,         // u8
+        INSTRUCTION_DESTINATION,    // u8
+        INSTRUCTION_OPERAND1,       // u8
+        INSTRUCTION_OPERAND2,       // u8
+        INSTRUCTION_TARGET,         // i32, the instruction that's jumped to, -1 if there is none
+        SYMBOL_INDEX,               // u32, the slot in the symbol table
+        SYMBOL_KIND,                // IrValueKind
+        SYMBOL_VALUE,               // u64
+        SID_HASH,                   // sid64
+        SID_NAME,                   // u32, string, IR_NONE if the sidbase doesn't have it
+        COUNT,
+    };
+
+    enum class IrValueKind : u8 {
+        NONE,
+        INT,
+        FLOAT,
+        SID,
+        STRING,
+        POINTER,
+    };
+
+    struct IrColumnLayout {
+        IrTable m_table;
+        u8 m_elementSize;
+    };
+
+    inline constexpr IrColumnLayout IR_COLUMN_LAYOUTS[static_cast<u64>(IrColumn::COUNT)] = {
+        { IrTable::ENTRIES, 8 }, { IrTable::ENTRIES, 8 }, { IrTable::ENTRIES, 4 },
+        { IrTable::STRUCTS, 4 }, { IrTable::STRUCTS, 8 }, { IrTable::STRUCTS, 8 }, { IrTable::STRUCTS, 4 }, { IrTable::STRUCTS, 4 }, { IrTable::STRUCTS, 4 },
+        { IrTable::MEMBERS, 4 }, { IrTable::MEMBERS, 4 }, { IrTable::MEMBERS, 1 }, { IrTable::MEMBERS, 8 },
+        { IrTable::FUNCTIONS, 4 }, { IrTable::FUNCTIONS, 4 }, { IrTable::FUNCTIONS, 4 }, { IrTable::FUNCTIONS, 4 }, { IrTable::FUNCTIONS, 4 },
+        { IrTable::FUNCTIONS, 4 }, { IrTable::FUNCTIONS, 4 }, { IrTable::FUNCTIONS, 4 }, { IrTable::FUNCTIONS, 4 }, { IrTable::FUNCTIONS, 4 },
+        { IrTable::INSTRUCTIONS, 1 }, { IrTable::INSTRUCTIONS, 1 }, { IrTable::INSTRUCTIONS, 1 }, { IrTable::INSTRUCTIONS, 1 }, { IrTable::INSTRUCTIONS, 4 },
+        { IrTable::SYMBOLS, 4 }, { IrTable::SYMBOLS, 1 }, { IrTable::SYMBOLS, 8 },
+        { IrTable::SIDS, 8 }, { IrTable::SIDS, 4 },
+    };
+
+    inline constexpr u32 IR_NONE = 0xFFFFFFFF;
+
+    struct IrHeader {
+        u32 m_magic;
+        u32 m_version;
+        u64 m_rows[static_cast<u64>(IrTable::COUNT)];
+        u64 m_columns[static_cast<u64>(IrColumn::COUNT)];
+        u64 m_stringsOffset;
+    };
+
+    // collects the tables while a file is disassembled, in the order the listing is produced
+    class IrBuilder {
+    public:
+        void add_entry(const sid64 name, const sid64 type);
+        void begin_struct(const u32 offset, const sid64 type, const sid64 key);
+        void end_struct();
+        void add_member(const u32 offset, const IrValueKind kind, const u64 value);
+        // also adds the function's instructions, its symbols follow through add_symbol
+        void add_function(const u32 offset, const u32 code, const u32 symbol_table, const FunctionDisassembly& function);
+        void add_symbol(const u32 index, const IrValueKind kind, const u64 value);
+        [[nodiscard]] u32 add_string(const char* str);
+        void add_sid(const sid64 sid) {
+            m_sidHash.push_back(sid);
+        }
+
+        // resolves the sids against sidbase and writes the file
+        [[nodiscard]] b8 write(const std::filesystem::path& path, const SIDBase& sidbase);
+
+    private:
+        std::vector<sid64> m_entryName;
+        std::vector<sid64> m_entryType;
+        std::vector<u32> m_entryStruct;
+        std::vector<u32> m_structOffset;
+        std::vector<sid64> m_structType;
+        std::vector<sid64> m_structKey;
+        std::vector<u32> m_structParent;
+        std::vector<u32> m_memberStruct;
+        std::vector<u32> m_memberOffset;
+        std::vector<IrValueKind> m_memberKind;
+        std::vector<u64> m_memberValue;
+        std::vector<u32> m_functionOffset;
+        std::vector<u32> m_functionName;
+        std::vector<u32> m_functionStruct;
+        std::vector<u32> m_functionCode;
+        std::vector<u32> m_functionArgs;
+        std::vector<u32> m_functionSymbolTable;
+        std::vector<u32> m_functionFirstInstruction;
+        std::vector<u32> m_functionNumInstructions;
+        std::vector<u32> m_functionFirstSymbol;
+        std::vector<u32> m_functionNumSymbols;
+        std::vector<u8> m_instructionOpcode;
+        std::vector<u8> m_instructionDestination;
+        std::vector<u8> m_instructionOperand1;
+        std::vector<u8> m_instructionOperand2;
+        std::vector<i32> m_instructionTarget;
+        std::vector<u32> m_symbolIndex;
+        std::vector<IrValueKind> m_symbolKind;
+        std::vector<u64> m_symbolValue;
+        std::vector<sid64> m_sidHash;
+        std::vector<char> m_strings;
+        std::unordered_map<std::string, u32> m_stringOffsets;
+        // rows of the structs that are still open
+        std::vector<u32> m_scopes;
+    };
+
+    // a mapped .dcir file. the columns are used straight out of the mapping.
+    class IrFile {
+    public:
+        [[nodiscard]] b8 open(const std::filesystem::path& path) noexcept;
+
+        [[nodiscard]] u64 rows(const IrTable table) const noexcept {
+            return m_header->m_rows[static_cast<u64>(table)];
+        }
+
+        // empty if T doesn't have the size of the column's elements
+        template<typename T>
+        [[nodiscard]] std::span<const T> column(const IrColumn column) const noexcept {
+            const IrColumnLayout& layout = IR_COLUMN_LAYOUTS[static_cast<u64>(column)];
+            if (sizeof(T) != layout.m_elementSize) {
+                return {};
+            }
+            return { reinterpret_cast<const T*>(m_mapping.data() + m_header->m_columns[static_cast<u64>(column)]), rows(layout.m_table) };
+        }
+
+        // nullptr for IR_NONE or an offset outside of the pool
+        [[nodiscard]] const char* string_at(const u32 offset) const noexcept;
+        // nullptr if the sid isn't in the file or the sidbase didn't have it
+        [[nodiscard]] const char* sid_name(const sid64 sid) const noexcept;
+
+    private:
+        MappedFile m_mapping;
+        const IrHeader* m_header = nullptr;
+    };
+}
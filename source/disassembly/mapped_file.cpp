@@ -0,0 +1,131 @@
+#include "mapped_file.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace dconstruct {
+    MappedFile::MappedFile(MappedFile&& rhs) noexcept : m_data(rhs.m_data), m_size(rhs.m_size) {
+        rhs.m_data = nullptr;
+        rhs.m_size = 0;
+    }
+
+    MappedFile& MappedFile::operator=(MappedFile&& rhs) noexcept {
+        if (this != &rhs) {
+            close();
+            m_data = rhs.m_data;
+            m_size = rhs.m_size;
+            rhs.m_data = nullptr;
+            rhs.m_size = 0;
+        }
+        return *this;
+    }
+
+    MappedFile::~MappedFile() {
+        close();
+    }
+
+#ifdef _WIN32
+    [[nodiscard]] b8 MappedFile::open(const std::filesystem::path& path, const MapAccess access) noexcept {
+        close();
+        HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+            CloseHandle(file);
+            return false;
+        }
+
+        const DWORD protect = access == MapAccess::COPY_ON_WRITE ? PAGE_WRITECOPY : PAGE_READONLY;
+        HANDLE mapping = CreateFileMappingW(file, nullptr, protect, 0, 0, nullptr);
+        CloseHandle(file);
+        if (mapping == nullptr) {
+            return false;
+        }
+
+        const DWORD view_access = access == MapAccess::COPY_ON_WRITE ? FILE_MAP_COPY : FILE_MAP_READ;
+        void* view = MapViewOfFile(mapping, view_access, 0, 0, 0);
+        CloseHandle(mapping);
+        if (view == nullptr) {
+            return false;
+        }
+
+        m_data = reinterpret_cast<std::byte*>(view);
+        m_size = file_size.QuadPart;
+        return true;
+    }
+
+    void MappedFile::close() noexcept {
+        if (m_data != nullptr) {
+            UnmapViewOfFile(m_data);
+        }
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    // a FILE_MAP_COPY view can't drop its copied pages without unmapping the whole view
+    void MappedFile::discard(const u64, const u64) const noexcept {}
+
+    [[nodiscard]] b8 MappedFile::can_discard() noexcept {
+        return false;
+    }
+#else
+    [[nodiscard]] b8 MappedFile::open(const std::filesystem::path& path, const MapAccess access) noexcept {
+        close();
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+
+        const int prot = access == MapAccess::COPY_ON_WRITE ? PROT_READ | PROT_WRITE : PROT_READ;
+        void* view = mmap(nullptr, st.st_size, prot, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (view == MAP_FAILED) {
+            return false;
+        }
+
+        m_data = reinterpret_cast<std::byte*>(view);
+        m_size = st.st_size;
+        return true;
+    }
+
+    void MappedFile::close() noexcept {
+        if (m_data != nullptr) {
+            munmap(m_data, m_size);
+        }
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    void MappedFile::discard(const u64 begin, const u64 end) const noexcept {
+        static const u64 page_size = sysconf(_SC_PAGESIZE);
+        const u64 first = (begin + page_size - 1) / page_size * page_size;
+        const u64 last = std::min(end, m_size) / page_size * page_size;
+        if (m_data != nullptr && first < last) {
+            madvise(m_data + first, last - first, MADV_DONTNEED);
+        }
+    }
+
+    [[nodiscard]] b8 MappedFile::can_discard() noexcept {
+        return true;
+    }
+#endif
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "base.h"
+#include <filesystem>
+
+namespace dconstruct {
+    enum class MapAccess : u8 {
+        READ_ONLY,
+        COPY_ON_WRITE,
+    };
+
+    // thin wrapper around mmap/MapViewOfFile. with COPY_ON_WRITE the mapping is private,
+    // so writes only ever copy the touched pages and never reach the file on disk.
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile(MappedFile&& rhs) noexcept;
+        MappedFile& operator=(MappedFile&& rhs) noexcept;
+        ~MappedFile();
+
+        [[nodiscard]] b8 open(const std::filesystem::path& path, const MapAccess access) noexcept;
+        void close() noexcept;
+
+        [[nodiscard]] std::byte* data() const noexcept {
+            return m_data;
+        }
+
+        [[nodiscard]] u64 size() const noexcept {
+            return m_size;
+        }
+
+        [[nodiscard]] b8 is_open() const noexcept {
+            return m_data != nullptr;
+        }
+
+        // drops the private copies of the pages that lie entirely inside [begin, end), so they're read from the
+        // file again the next time they're touched. a no-op where discard isn't supported.
+        void discard(const u64 begin, const u64 end) const noexcept;
+
+        // whether discard() can give copy-on-write pages back on this platform
+        [[nodiscard]] static b8 can_discard() noexcept;
+
+    private:
+        std::byte* m_data = nullptr;
+        u64 m_size = 0;
+    };
+}
@@ -0,0 +1,413 @@
+#include "ndjson_disassembler.h"
+#include <charconv>
+#include <cmath>
+#include <iostream>
+
+namespace dconstruct {
+    // length of the well formed utf-8 sequence that starts at str, or 0 if it isn't one.
+    // overlong forms, surrogates and code points past U+10FFFF don't count as well formed.
+    [[nodiscard]] static u64 utf8_sequence_length(const u8* str) noexcept {
+        const u8 lead = str[0];
+        u64 length;
+        u8 min_second = 0x80;
+        u8 max_second = 0xBF;
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            length = 2;
+        } else if (lead >= 0xE0 && lead <= 0xEF) {
+            length = 3;
+            if (lead == 0xE0) {
+                min_second = 0xA0;
+            } else if (lead == 0xED) {
+                max_second = 0x9F;
+            }
+        } else if (lead >= 0xF0 && lead <= 0xF4) {
+            length = 4;
+            if (lead == 0xF0) {
+                min_second = 0x90;
+            } else if (lead == 0xF4) {
+                max_second = 0x8F;
+            }
+        } else {
+            return 0;
+        }
+        if (str[1] < min_second || str[1] > max_second) {
+            return 0;
+        }
+        // the terminator isn't a continuation byte, so these never read past the end of the string
+        for (u64 i = 2; i < length; ++i) {
+            if (str[i] < 0x80 || str[i] > 0xBF) {
+                return 0;
+            }
+        }
+        return length;
+    }
+
+    NdjsonDisassembler::NdjsonDisassembler(BinaryFile* file, const SIDBase* sidbase, const std::string& out_file, const DisassemblerOptions& options) {
+        m_currentFile = file;
+        m_sidbase = sidbase;
+        m_options = options;
+        m_discardText = true;
+        (void)m_out.open(out_file, options.m_output);
+    }
+
+    void NdjsonDisassembler::complete() {
+        if (!m_out.close()) {
+            std::cout << "error: couldn't write the listing of " << m_currentFile->m_path << '\n';
+        }
+    }
+
+    void NdjsonDisassembler::begin_entry(const u32 index, const Entry* entry) {
+        m_scopes.clear();
+        write_object_start("entry");
+        write_key("index");
+        write_uint(index);
+        write_sid("name", entry->m_nameID);
+        write_sid("type", entry->m_typeId);
+        write_key("offset");
+        write_uint(get_offset(m_currentFile->resolve(entry->m_entryPtr)));
+        write("}\n");
+    }
+
+    void NdjsonDisassembler::insert_map_key(const sid64 key) {
+        m_mapKey = key;
+        m_hasMapKey = true;
+    }
+
+    void NdjsonDisassembler::begin_struct(const u32 offset, const sid64 type_id) {
+        write_object_start("struct");
+        write_parent();
+        write_key("offset");
+        write_uint(offset);
+        // elements of arrays have no type
+        if (type_id != 0) {
+            write_sid("type", type_id);
+        }
+        if (m_hasMapKey) {
+            write_sid("key", m_mapKey);
+            m_hasMapKey = false;
+        }
+        write("}\n");
+        m_scopes.push_back(Scope{ offset, 0 });
+    }
+
+    void NdjsonDisassembler::end_struct() {
+        if (!m_scopes.empty()) {
+            m_scopes.pop_back();
+        }
+    }
+
+    void NdjsonDisassembler::insert_value(const location member, const MemberKind kind) {
+        write_object_start("member");
+        write_parent();
+        write_key("index");
+        write_uint(m_scopes.empty() ? 0 : m_scopes.back().m_numMembers++);
+        write_key("offset");
+        write_uint(get_offset(member));
+        switch (kind) {
+            case MemberKind::POINTER: {
+                // the struct or array it points at follows with this offset
+                const location target = m_currentFile->deref(member);
+                if (m_currentFile->is_string(target)) {
+                    write(",\"value_kind\":\"string\",\"value\":");
+                    write_string(target.as<char>());
+                } else {
+                    write(",\"value_kind\":\"pointer\",\"value\":");
+                    write_uint(get_offset(target));
+                }
+                break;
+            }
+            case MemberKind::STRING: {
+                write(",\"value_kind\":\"string\",\"value\":");
+                write_string(member.as<char>());
+                break;
+            }
+            case MemberKind::RAW_STRING: {
+                write(",\"value_kind\":\"string\",\"value\":");
+                write_string(member.get<char*>());
+                break;
+            }
+            case MemberKind::SID: {
+                write(",\"value_kind\":\"sid\"");
+                write_sid("value", member.get<sid64>());
+                break;
+            }
+            case MemberKind::FLOAT: {
+                write(",\"value_kind\":\"float\",\"value\":");
+                write_float(member.get<f32>());
+                break;
+            }
+            case MemberKind::INT: {
+                write(",\"value_kind\":\"int\",\"value\":");
+                write_int(member.get<i32>());
+                break;
+            }
+        }
+        write("}\n");
+    }
+
+    void NdjsonDisassembler::insert_declaration(const SsDeclaration* var) {
+        write_object_start("declaration");
+        write_parent();
+        write_key("offset");
+        write_uint(get_offset(var));
+        write_sid("name", var->m_declId);
+        write_sid("type", var->m_declTypeId);
+
+        const void* decl_value = m_currentFile->resolve(var->m_pDeclValue);
+        if (decl_value == nullptr) {
+            write(",\"value\":null}\n");
+            return;
+        }
+        switch (var->m_declTypeId) {
+            case SID("boolean"): {
+                write(*reinterpret_cast<const b8*>(decl_value) ? ",\"value\":true" : ",\"value\":false");
+                break;
+            }
+            case SID("vector"):
+            case SID("quat"): {
+                write_key("value");
+                write_floats(reinterpret_cast<const f32*>(decl_value), 4);
+                break;
+            }
+            case SID("point"): {
+                write_key("value");
+                write_floats(reinterpret_cast<const f32*>(decl_value), 3);
+                break;
+            }
+            case SID("float"):
+            case SID("timer"):
+            case SID("bound-frame"): {
+                write_key("value");
+                write_float(*reinterpret_cast<const f32*>(decl_value));
+                break;
+            }
+            case SID("string"): {
+                write_key("value");
+                write_string(m_currentFile->resolve(*reinterpret_cast<const char* const*>(decl_value)));
+                break;
+            }
+            case SID("symbol"): {
+                write_sid("value", *reinterpret_cast<const sid64*>(decl_value));
+                break;
+            }
+            case SID("int32"): {
+                write_key("value");
+                write_int(*reinterpret_cast<const i32*>(decl_value));
+                break;
+            }
+            case SID("uint64"): {
+                write_key("value");
+                write_uint(*reinterpret_cast<const u64*>(decl_value));
+                break;
+            }
+            default: {
+                write(",\"value\":null");
+                break;
+            }
+        }
+        write("}\n");
+    }
+
+    void NdjsonDisassembler::insert_function(const ScriptLambda* lambda, const FunctionDisassembly& function) {
+        write_object_start("function");
+        write_parent();
+        write_key("offset");
+        write_uint(get_offset(lambda));
+        write_key("name");
+        write_string(function.m_id.c_str());
+        write_key("code");
+        write_uint(get_offset(m_currentFile->resolve(lambda->m_pOpcode)));
+        write_key("args");
+        write_uint(function.m_stackFrame.m_argCount);
+
+        write(",\"instructions\":[");
+        for (u64 i = 0; i < function.m_lines.size(); ++i) {
+            const FunctionDisassemblyLine& line = function.m_lines[i];
+            write(i == 0 ? "{\"opcode\":\"" : ",{\"opcode\":\"");
+            write(line.m_instruction.opcode_to_string());
+            write("\",\"dst\":");
+            write_uint(line.m_instruction.destination);
+            write(",\"op1\":");
+            write_uint(line.m_instruction.operand1);
+            write(",\"op2\":");
+            write_uint(line.m_instruction.operand2);
+            if (line.m_target != -1) {
+                write(",\"target\":");
+                write_int(line.m_target);
+            }
+            write("}");
+        }
+
+        write("],\"symbols\":[");
+        const location table = function.m_stackFrame.m_symbolTable;
+        b8 first = true;
+        for (const auto& [i, entry] : function.m_stackFrame.symbolTableEntries) {
+            write(first ? "{\"index\":" : ",{\"index\":");
+            first = false;
+            write_uint(i);
+            write(",\"offset\":");
+            write_uint(get_offset(table + i * 8));
+            switch (entry.m_type) {
+                case SymbolTableEntryType::FLOAT: {
+                    write(",\"value_kind\":\"float\",\"value\":");
+                    write_float(entry.m_f32);
+                    break;
+                }
+                case SymbolTableEntryType::INT: {
+                    write(",\"value_kind\":\"int\",\"value\":");
+                    write_int(entry.m_i64);
+                    break;
+                }
+                case SymbolTableEntryType::STRING: {
+                    write(",\"value_kind\":\"string\",\"value\":");
+                    write_string(reinterpret_cast<const char*>(entry.m_pointer));
+                    break;
+                }
+                case SymbolTableEntryType::POINTER: {
+                    // pointers into the file are written as offsets, everything else in these slots is a hash
+                    if (m_currentFile->contains(entry.m_pointer)) {
+                        write(",\"value_kind\":\"pointer\",\"value\":");
+                        write_uint(get_offset(reinterpret_cast<const void*>(entry.m_pointer)));
+                    } else {
+                        write(",\"value_kind\":\"sid\"");
+                        write_sid("value", entry.m_pointer);
+                    }
+                    break;
+                }
+                case SymbolTableEntryType::STRINGID_64: {
+                    write(",\"value_kind\":\"sid\"");
+                    write_sid("value", entry.m_hash);
+                    break;
+                }
+                case SymbolTableEntryType::NONE:
+                case SymbolTableEntryType::UNKNOWN_TYPE: {
+                    write(",\"value_kind\":\"unknown\",\"value\":");
+                    write_int(entry.m_i64);
+                    break;
+                }
+            }
+            write("}");
+        }
+        write("]}\n");
+    }
+
+    void NdjsonDisassembler::write_key(const char* name) {
+        write(",\"");
+        write(name);
+        write("\":");
+    }
+
+    void NdjsonDisassembler::write_object_start(const char* kind) {
+        write("{\"kind\":\"");
+        write(kind);
+        write("\"");
+    }
+
+    void NdjsonDisassembler::write_parent() {
+        write_key("parent");
+        if (m_scopes.empty()) {
+            write("null");
+        } else {
+            write_uint(m_scopes.back().m_offset);
+        }
+    }
+
+    void NdjsonDisassembler::write_string(const char* str) {
+        if (str == nullptr) {
+            write("null");
+            return;
+        }
+        static constexpr char HEX_DIGITS[] = "0123456789abcdef";
+        write("\"");
+        // everything up to the next character that has to be escaped is copied as it is
+        const char* run = str;
+        for (; *str != '\0'; ++str) {
+            const u8 c = static_cast<u8>(*str);
+            if (c >= 0x80) {
+                // valid utf-8 is copied as it is, any other byte is escaped as the code point of the same value
+                const u64 length = utf8_sequence_length(reinterpret_cast<const u8*>(str));
+                if (length != 0) {
+                    str += length - 1;
+                    continue;
+                }
+            } else if (c >= 0x20 && c != '"' && c != '\\') {
+                continue;
+            }
+            m_out.append(run, str - run);
+            run = str + 1;
+            switch (c) {
+                case '"': {
+                    write("\\\"");
+                    break;
+                }
+                case '\\': {
+                    write("\\\\");
+                    break;
+                }
+                case '\n': {
+                    write("\\n");
+                    break;
+                }
+                case '\t': {
+                    write("\\t");
+                    break;
+                }
+                case '\r': {
+                    write("\\r");
+                    break;
+                }
+                default: {
+                    const char escaped[] = { '\\', 'u', '0', '0', HEX_DIGITS[c >> 4], HEX_DIGITS[c & 0xF] };
+                    m_out.append(escaped, sizeof(escaped));
+                    break;
+                }
+            }
+        }
+        m_out.append(run, str - run);
+        write("\"");
+    }
+
+    void NdjsonDisassembler::write_int(const i64 value) {
+        char digits[24];
+        const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        m_out.append(digits, result.ptr - digits);
+    }
+
+    void NdjsonDisassembler::write_uint(const u64 value) {
+        char digits[24];
+        const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        m_out.append(digits, result.ptr - digits);
+    }
+
+    void NdjsonDisassembler::write_float(const f32 value) {
+        // json has no inf or nan
+        if (!std::isfinite(value)) {
+            write("null");
+            return;
+        }
+        char digits[64];
+        const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        m_out.append(digits, result.ptr - digits);
+    }
+
+    void NdjsonDisassembler::write_sid(const char* name, const sid64 sid) {
+        write_key(name);
+        write_string(lookup(sid));
+        write(",\"");
+        write(name);
+        write("_sid\":\"");
+        format_to(m_out, MAX_SPAN_LENGTH, "#%016llX", sid);
+        write("\"");
+    }
+
+    void NdjsonDisassembler::write_floats(const f32* values, const u32 count) {
+        write("[");
+        for (u32 i = 0; i < count; ++i) {
+            if (i != 0) {
+                write(",");
+            }
+            write_float(values[i]);
+        }
+        write("]");
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "disassembler.h"
+#include "output_stream.h"
+#include <string>
+#include <vector>
+
+namespace dconstruct {
+    /*
+        writes what the listing shows as newline delimited json, one object per line for every entry, struct, member,
+        state script declaration and function, so other tools can read it without parsing the text.
+        the objects come out of the same traversal as the listing and are written straight into the output.
+        every object has a "kind", and everything inside of an entry has the offset of the struct it's in as "parent".
+        sids are written as "#%016llX" strings next to their names, they don't fit into a json number.
+    */
+    class NdjsonDisassembler : public Disassembler {
+
+    public:
+        NdjsonDisassembler(BinaryFile* file, const SIDBase* sidbase, const std::string& out_file, const DisassemblerOptions& options);
+
+    private:
+        struct Scope {
+            u32 m_offset;
+            u32 m_numMembers;
+        };
+
+        OutputStream m_out;
+        std::vector<Scope> m_scopes;
+        sid64 m_mapKey = 0;
+        b8 m_hasMapKey = false;
+
+        void insert_span(const char* text, const u32 indent = 0, const TextFormat& text_format = TextFormat{}) override {}
+        void complete() override;
+
+        void begin_entry(const u32 index, const Entry* entry) override;
+        void insert_map_key(const sid64 key) override;
+        void begin_struct(const u32 offset, const sid64 type_id) override;
+        void end_struct() override;
+        void insert_value(const location member, const MemberKind kind) override;
+        void insert_declaration(const SsDeclaration* var) override;
+        void insert_function(const ScriptLambda* lambda, const FunctionDisassembly& function) override;
+
+        void write(const char* text) {
+            m_out.append(text, std::strlen(text));
+        }
+
+        // ,"name": in front of every field but the first
+        void write_key(const char* name);
+        void write_object_start(const char* kind);
+        void write_parent();
+        void write_string(const char* str);
+        void write_int(const i64 value);
+        void write_uint(const u64 value);
+        void write_float(const f32 value);
+        // "name":"<resolved>","name_sid":"#..."
+        void write_sid(const char* name, const sid64 sid);
+        void write_floats(const f32* values, const u32 count);
+    };
+}
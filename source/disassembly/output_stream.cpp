@@ -0,0 +1,285 @@
+#include "output_stream.h"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#ifdef DCONSTRUCT_ZSTD
+#include <zstd.h>
+#endif
+#ifdef DCONSTRUCT_ZLIB
+#include <zlib.h>
+#endif
+
+namespace dconstruct {
+    // compresses everything that's written through it into a file
+    class OutputCompressor {
+    public:
+        virtual ~OutputCompressor() = default;
+        [[nodiscard]] virtual b8 write(FILE* file, const std::byte* data, const u64 size) = 0;
+        // writes out whatever is still buffered and ends the stream
+        [[nodiscard]] virtual b8 finish(FILE* file) = 0;
+    };
+
+#ifdef DCONSTRUCT_ZSTD
+    class ZstdCompressor final : public OutputCompressor {
+    public:
+        explicit ZstdCompressor(const OutputOptions& options) : m_context(ZSTD_createCCtx()), m_out(ZSTD_CStreamOutSize()) {
+            ZSTD_CCtx_setParameter(m_context, ZSTD_c_compressionLevel, options.m_level != 0 ? options.m_level : ZSTD_CLEVEL_DEFAULT);
+            // fails without effect if the library was built without threads
+            ZSTD_CCtx_setParameter(m_context, ZSTD_c_nbWorkers, static_cast<int>(options.m_threads));
+        }
+
+        ~ZstdCompressor() override {
+            ZSTD_freeCCtx(m_context);
+        }
+
+        [[nodiscard]] b8 write(FILE* file, const std::byte* data, const u64 size) override {
+            return compress(file, data, size, ZSTD_e_continue);
+        }
+
+        [[nodiscard]] b8 finish(FILE* file) override {
+            return compress(file, nullptr, 0, ZSTD_e_end);
+        }
+
+    private:
+        ZSTD_CCtx* m_context;
+        std::vector<char> m_out;
+
+        [[nodiscard]] b8 compress(FILE* file, const std::byte* data, const u64 size, const ZSTD_EndDirective mode) {
+            if (m_context == nullptr) {
+                return false;
+            }
+            ZSTD_inBuffer in{ data, size, 0 };
+            while (true) {
+                ZSTD_outBuffer out{ m_out.data(), m_out.size(), 0 };
+                const size_t remaining = ZSTD_compressStream2(m_context, &out, &in, mode);
+                if (ZSTD_isError(remaining) || fwrite(m_out.data(), 1, out.pos, file) != out.pos) {
+                    return false;
+                }
+                if (mode == ZSTD_e_end ? remaining == 0 : in.pos == in.size) {
+                    return true;
+                }
+            }
+        }
+    };
+#endif
+
+#ifdef DCONSTRUCT_ZLIB
+    class GzipCompressor final : public OutputCompressor {
+    public:
+        static constexpr u64 OUT_SIZE = 0x20000;
+
+        explicit GzipCompressor(const OutputOptions& options) : m_out(OUT_SIZE) {
+            // 16 more window bits write a gzip header instead of a zlib one
+            m_ok = deflateInit2(&m_stream, options.m_level != 0 ? options.m_level : Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+        }
+
+        ~GzipCompressor() override {
+            if (m_ok) {
+                deflateEnd(&m_stream);
+            }
+        }
+
+        [[nodiscard]] b8 write(FILE* file, const std::byte* data, const u64 size) override {
+            return compress(file, data, size, Z_NO_FLUSH);
+        }
+
+        [[nodiscard]] b8 finish(FILE* file) override {
+            return compress(file, nullptr, 0, Z_FINISH);
+        }
+
+    private:
+        z_stream m_stream{};
+        std::vector<char> m_out;
+        b8 m_ok = false;
+
+        [[nodiscard]] b8 compress(FILE* file, const std::byte* data, const u64 size, const int flush) {
+            if (!m_ok) {
+                return false;
+            }
+            m_stream.next_in = reinterpret_cast<Bytef*>(const_cast<std::byte*>(data));
+            m_stream.avail_in = static_cast<uInt>(size);
+            do {
+                m_stream.next_out = reinterpret_cast<Bytef*>(m_out.data());
+                m_stream.avail_out = static_cast<uInt>(m_out.size());
+                if (deflate(&m_stream, flush) == Z_STREAM_ERROR) {
+                    return false;
+                }
+                const u64 produced = m_out.size() - m_stream.avail_out;
+                if (fwrite(m_out.data(), 1, produced, file) != produced) {
+                    return false;
+                }
+            } while (m_stream.avail_out == 0);
+            return true;
+        }
+    };
+#endif
+
+    [[nodiscard]] static std::unique_ptr<OutputCompressor> make_compressor(const OutputOptions& options) {
+        switch (options.m_compression) {
+#ifdef DCONSTRUCT_ZSTD
+            case OutputCompression::ZSTD: {
+                return std::make_unique<ZstdCompressor>(options);
+            }
+#endif
+#ifdef DCONSTRUCT_ZLIB
+            case OutputCompression::GZIP: {
+                return std::make_unique<GzipCompressor>(options);
+            }
+#endif
+            default: {
+                return nullptr;
+            }
+        }
+    }
+
+    [[nodiscard]] b8 is_compression_supported(const OutputCompression compression) noexcept {
+        switch (compression) {
+            case OutputCompression::NONE: {
+                return true;
+            }
+            case OutputCompression::ZSTD: {
+#ifdef DCONSTRUCT_ZSTD
+                return true;
+#else
+                return false;
+#endif
+            }
+            case OutputCompression::GZIP: {
+#ifdef DCONSTRUCT_ZLIB
+                return true;
+#else
+                return false;
+#endif
+            }
+        }
+        return false;
+    }
+
+    [[nodiscard]] const char* compression_extension(const OutputCompression compression) noexcept {
+        switch (compression) {
+            case OutputCompression::ZSTD: {
+                return ".zst";
+            }
+            case OutputCompression::GZIP: {
+                return ".gz";
+            }
+            default: {
+                return "";
+            }
+        }
+    }
+
+    OutputStream::OutputStream() = default;
+
+    OutputStream::~OutputStream() {
+        close();
+    }
+
+    [[nodiscard]] b8 OutputStream::open(const std::filesystem::path& path, const OutputOptions& options) {
+        close();
+        m_chunks[0] = BufferPool::local()->take(CHUNK_SIZE);
+        m_current = 0;
+        m_chunk = reinterpret_cast<char*>(m_chunks[0].get());
+        m_used = 0;
+        m_stop = false;
+        m_failed = false;
+
+        m_file = fopen(path.string().c_str(), "wb");
+        if (m_file == nullptr) {
+            std::cout << "error: couldn't open " << path << " for writing\n";
+            return false;
+        }
+        // the chunks already are the buffer
+        setvbuf(m_file, nullptr, _IONBF, 0);
+        m_compressor = make_compressor(options);
+        return true;
+    }
+
+    void OutputStream::append_across_chunks(const char* text, u64 length) {
+        while (length > 0) {
+            const u64 part = std::min(length, CHUNK_SIZE - m_used);
+            std::memcpy(m_chunk + m_used, text, part);
+            m_used += part;
+            text += part;
+            length -= part;
+            if (m_used == CHUNK_SIZE) {
+                hand_off();
+            }
+        }
+    }
+
+    void OutputStream::hand_off() {
+        if (!m_writer.joinable()) {
+            m_chunks[1] = BufferPool::local()->take(CHUNK_SIZE);
+            m_writer = std::thread(&OutputStream::run, this);
+        }
+        {
+            // the other chunk can only be filled again once the writer is done with it
+            std::unique_lock lock(m_mutex);
+            m_condition.wait(lock, [this] { return m_pendingSize == 0; });
+            m_pendingChunk = m_current;
+            m_pendingSize = m_used;
+        }
+        m_condition.notify_all();
+        m_current ^= 1;
+        m_chunk = reinterpret_cast<char*>(m_chunks[m_current].get());
+        m_used = 0;
+    }
+
+    void OutputStream::run() {
+        std::unique_lock lock(m_mutex);
+        while (true) {
+            m_condition.wait(lock, [this] { return m_pendingSize != 0 || m_stop; });
+            if (m_pendingSize == 0) {
+                return;
+            }
+            const std::byte* data = m_chunks[m_pendingChunk].get();
+            const u64 size = m_pendingSize;
+            lock.unlock();
+            write(data, size);
+            lock.lock();
+            m_pendingSize = 0;
+            m_condition.notify_all();
+        }
+    }
+
+    void OutputStream::write(const std::byte* data, const u64 size) {
+        if (m_file == nullptr) {
+            return;
+        }
+        const b8 written = m_compressor != nullptr ? m_compressor->write(m_file, data, size) : fwrite(data, 1, size, m_file) == size;
+        if (!written) {
+            m_failed = true;
+        }
+    }
+
+    b8 OutputStream::close() {
+        if (m_chunk == nullptr) {
+            return !m_failed;
+        }
+        if (m_writer.joinable()) {
+            {
+                std::lock_guard lock(m_mutex);
+                m_stop = true;
+            }
+            m_condition.notify_all();
+            m_writer.join();
+        }
+        write(reinterpret_cast<const std::byte*>(m_chunk), m_used);
+        if (m_file != nullptr && m_compressor != nullptr && !m_compressor->finish(m_file)) {
+            m_failed = true;
+        }
+        m_compressor.reset();
+        if (m_file != nullptr && fclose(m_file) != 0) {
+            m_failed = true;
+        }
+        m_file = nullptr;
+        m_chunk = nullptr;
+        m_used = 0;
+        m_chunks[0] = PooledBuffer{};
+        m_chunks[1] = PooledBuffer{};
+        return !m_failed;
+    }
+}
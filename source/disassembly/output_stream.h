@@ -0,0 +1,85 @@
+#pragma once
+
+#include "base.h"
+#include "buffer_pool.h"
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace dconstruct {
+    enum class OutputCompression : u8 {
+        NONE,
+        ZSTD,
+        GZIP,
+    };
+
+    struct OutputOptions {
+        OutputCompression m_compression = OutputCompression::NONE;
+        i32 m_level = 0;        // 0 for the default level of the compression
+        u32 m_threads = 0;      // zstd only. extra threads that compress the file, 0 compresses on the writer thread.
+    };
+
+    // whether this build can write that compression
+    [[nodiscard]] b8 is_compression_supported(const OutputCompression compression) noexcept;
+    // extension that gets added to a compressed file, empty without compression
+    [[nodiscard]] const char* compression_extension(const OutputCompression compression) noexcept;
+
+    class OutputCompressor;
+
+    /*
+        writes a file through two fixed size chunks. once one is full it's handed to a writer thread, and the other one
+        fills up in the meantime, so writing to disk overlaps with producing the text and the memory doesn't grow with
+        the size of the file. the thread is only started when the first chunk is full, a file that fits into a single
+        chunk is written in close().
+        with compression, the chunks are compressed on their way to the file, so that happens on the writer thread too.
+    */
+    class OutputStream {
+    public:
+        static constexpr u64 CHUNK_SIZE = 0x80000;
+
+        OutputStream();
+        OutputStream(const OutputStream&) = delete;
+        OutputStream& operator=(const OutputStream&) = delete;
+        ~OutputStream();
+
+        // if the file can't be opened, the text is still taken but thrown away
+        [[nodiscard]] b8 open(const std::filesystem::path& path, const OutputOptions& options = {});
+
+        void append(const char* text, const u64 length) {
+            if (length <= CHUNK_SIZE - m_used) {
+                std::memcpy(m_chunk + m_used, text, length);
+                m_used += length;
+                return;
+            }
+            append_across_chunks(text, length);
+        }
+
+        // writes the rest and closes the file. false if a write failed.
+        b8 close();
+
+    private:
+        FILE* m_file = nullptr;
+        std::unique_ptr<OutputCompressor> m_compressor;
+        PooledBuffer m_chunks[2];
+        char* m_chunk = nullptr;
+        u32 m_current = 0;
+        u64 m_used = 0;
+
+        std::thread m_writer;
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+        u32 m_pendingChunk = 0;
+        u64 m_pendingSize = 0;      // 0 while the writer is idle
+        b8 m_stop = false;
+        b8 m_failed = false;
+
+        void append_across_chunks(const char* text, u64 length);
+        void hand_off();
+        void run();
+        void write(const std::byte* data, const u64 size);
+    };
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "base.h"
+#include <algorithm>
+#include <array>
+#include <execution>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+namespace dconstruct {
+    // stable lsd radix sort on a 64 bit key, one byte per pass. every pass counts and scatters in parallel over
+    // contiguous chunks, and passes where every key has the same byte are skipped.
+    template<typename T, typename KeyFunc>
+    void parallel_radix_sort(std::vector<T>& data, KeyFunc&& key) {
+        constexpr u64 min_chunk_size = 1 << 16;
+
+        const u64 size = data.size();
+        if (size < 2) {
+            return;
+        }
+
+        const u64 num_chunks = std::clamp<u64>(size / min_chunk_size, 1, std::max(1u, std::thread::hardware_concurrency()));
+        const u64 chunk_size = (size + num_chunks - 1) / num_chunks;
+        std::vector<u64> chunks(num_chunks);
+        std::iota(chunks.begin(), chunks.end(), 0);
+
+        std::vector<T> scratch(size);
+        T* src = data.data();
+        T* dst = scratch.data();
+        std::vector<std::array<u64, 256>> offsets(num_chunks);
+
+        for (u32 shift = 0; shift < 64; shift += 8) {
+            std::for_each(std::execution::par, chunks.begin(), chunks.end(), [&](const u64 chunk) {
+                std::array<u64, 256>& counts = offsets[chunk];
+                counts.fill(0);
+                const u64 end = std::min(size, (chunk + 1) * chunk_size);
+                for (u64 i = chunk * chunk_size; i < end; ++i) {
+                    ++counts[(key(src[i]) >> shift) & 0xFF];
+                }
+            });
+
+            // bucket major, chunk minor, so every chunk scatters its keys behind the ones of the chunks before it
+            b8 single_bucket = false;
+            u64 running = 0;
+            for (u32 bucket = 0; bucket < 256; ++bucket) {
+                u64 bucket_total = 0;
+                for (u64 chunk = 0; chunk < num_chunks; ++chunk) {
+                    const u64 count = offsets[chunk][bucket];
+                    offsets[chunk][bucket] = running;
+                    running += count;
+                    bucket_total += count;
+                }
+                single_bucket |= bucket_total == size;
+            }
+            if (single_bucket) {
+                continue;
+            }
+
+            std::for_each(std::execution::par, chunks.begin(), chunks.end(), [&](const u64 chunk) {
+                std::array<u64, 256>& next = offsets[chunk];
+                const u64 end = std::min(size, (chunk + 1) * chunk_size);
+                for (u64 i = chunk * chunk_size; i < end; ++i) {
+                    dst[next[(key(src[i]) >> shift) & 0xFF]++] = src[i];
+                }
+            });
+            std::swap(src, dst);
+        }
+
+        if (src != data.data()) {
+            std::copy(std::execution::par, src, src + size, data.data());
+        }
+    }
+}
@@ -0,0 +1,143 @@
+#include "relocation.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define DCONSTRUCT_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+namespace dconstruct::reloc {
+    static inline void mark_pointed_at(u8* pointed_at, const u64 bitmap_size, const u64 offset) noexcept {
+        if (offset / 64 < bitmap_size) {
+            pointed_at[offset / 64] |= (1 << ((offset / 8) % 8));
+        }
+    }
+
+    static void apply_scalar(std::byte* image, const u8* bitmap, const u64 bitmap_size, const p64 delta, u8* pointed_at) noexcept {
+        for_each_set_bit(bitmap, bitmap_size, [&](const u64 slot) {
+            u64* entry = reinterpret_cast<u64*>(image + slot * 8);
+            const u64 offset = *entry;
+            if (delta != 0) {
+                *entry = offset + delta;
+            }
+            if (pointed_at != nullptr) {
+                mark_pointed_at(pointed_at, bitmap_size, offset);
+            }
+        });
+    }
+
+#ifdef DCONSTRUCT_X86_DISPATCH
+    // one bitmap byte covers 8 slots = 64 bytes of the image. both kernels only visit the non-zero bytes of
+    // the bitmap, and only ever load/store the slots that are relocated. the masked loads don't fault
+    // on masked out lanes, so the last block may hang over the end of the file, and pages without pointers
+    // are never written to (which keeps copy-on-write mappings from copying them).
+
+    // lane masks for 4 bit nibbles of the relocation bitmap
+    alignas(32) static constexpr i64 AVX2_LANE_MASKS[16][4] = {
+        { 0,  0,  0,  0}, {-1,  0,  0,  0}, { 0, -1,  0,  0}, {-1, -1,  0,  0},
+        { 0,  0, -1,  0}, {-1,  0, -1,  0}, { 0, -1, -1,  0}, {-1, -1, -1,  0},
+        { 0,  0,  0, -1}, {-1,  0,  0, -1}, { 0, -1,  0, -1}, {-1, -1,  0, -1},
+        { 0,  0, -1, -1}, {-1,  0, -1, -1}, { 0, -1, -1, -1}, {-1, -1, -1, -1},
+    };
+
+    __attribute__((target("avx2")))
+    static void apply_avx2(std::byte* image, const u8* bitmap, const u64 bitmap_size, const p64 delta, u8* pointed_at) noexcept {
+        const __m256i _delta = _mm256_set1_epi64x(delta);
+        alignas(32) u64 offsets[8];
+
+        for (u64 word_idx = 0; word_idx < bitmap_size; word_idx += sizeof(u64)) {
+            u64 word = load_word(bitmap, bitmap_size, word_idx);
+            while (word != 0) {
+                u8 bits;
+                const u64 i = word_idx + pop_set_byte(word, bits);
+                long long* block = reinterpret_cast<long long*>(image + i * 64);
+                const __m256i _lo_mask = _mm256_load_si256(reinterpret_cast<const __m256i*>(AVX2_LANE_MASKS[bits & 0xF]));
+                const __m256i _hi_mask = _mm256_load_si256(reinterpret_cast<const __m256i*>(AVX2_LANE_MASKS[bits >> 4]));
+                const __m256i _lo = _mm256_maskload_epi64(block, _lo_mask);
+                const __m256i _hi = _mm256_maskload_epi64(block + 4, _hi_mask);
+                if (delta != 0) {
+                    _mm256_maskstore_epi64(block, _lo_mask, _mm256_add_epi64(_lo, _delta));
+                    _mm256_maskstore_epi64(block + 4, _hi_mask, _mm256_add_epi64(_hi, _delta));
+                }
+                if (pointed_at != nullptr) {
+                    _mm256_store_si256(reinterpret_cast<__m256i*>(offsets), _lo);
+                    _mm256_store_si256(reinterpret_cast<__m256i*>(offsets + 4), _hi);
+                    for (; bits != 0; bits &= bits - 1) {
+                        mark_pointed_at(pointed_at, bitmap_size, offsets[std::countr_zero(bits)]);
+                    }
+                }
+            }
+        }
+    }
+
+    __attribute__((target("avx512f")))
+    static void apply_avx512(std::byte* image, const u8* bitmap, const u64 bitmap_size, const p64 delta, u8* pointed_at) noexcept {
+        const __m512i _delta = _mm512_set1_epi64(delta);
+        alignas(64) u64 offsets[8];
+
+        for (u64 word_idx = 0; word_idx < bitmap_size; word_idx += sizeof(u64)) {
+            u64 word = load_word(bitmap, bitmap_size, word_idx);
+            while (word != 0) {
+                u8 bits;
+                const u64 i = word_idx + pop_set_byte(word, bits);
+                void* block = image + i * 64;
+                const __m512i _data = _mm512_maskz_loadu_epi64(bits, block);
+                if (delta != 0) {
+                    _mm512_mask_storeu_epi64(block, bits, _mm512_add_epi64(_data, _delta));
+                }
+                if (pointed_at != nullptr) {
+                    _mm512_store_si512(offsets, _data);
+                    for (; bits != 0; bits &= bits - 1) {
+                        mark_pointed_at(pointed_at, bitmap_size, offsets[std::countr_zero(bits)]);
+                    }
+                }
+            }
+        }
+    }
+#endif
+
+    [[nodiscard]] static Kernel select_kernel() noexcept {
+#ifdef DCONSTRUCT_X86_DISPATCH
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            return Kernel::AVX512;
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            return Kernel::AVX2;
+        }
+#endif
+        return Kernel::SCALAR;
+    }
+
+    [[nodiscard]] Kernel active_kernel() noexcept {
+        static const Kernel kernel = select_kernel();
+        return kernel;
+    }
+
+    [[nodiscard]] const char* kernel_name(const Kernel kernel) noexcept {
+        switch (kernel) {
+            case Kernel::SCALAR: return "scalar";
+            case Kernel::AVX2: return "avx2";
+            case Kernel::AVX512: return "avx512";
+        }
+        return "unknown";
+    }
+
+    void apply(std::byte* image, const u8* bitmap, const u64 bitmap_size, const p64 delta, u8* pointed_at) noexcept {
+        switch (active_kernel()) {
+#ifdef DCONSTRUCT_X86_DISPATCH
+            case Kernel::AVX512: {
+                apply_avx512(image, bitmap, bitmap_size, delta, pointed_at);
+                break;
+            }
+            case Kernel::AVX2: {
+                apply_avx2(image, bitmap, bitmap_size, delta, pointed_at);
+                break;
+            }
+#endif
+            default: {
+                apply_scalar(image, bitmap, bitmap_size, delta, pointed_at);
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "base.h"
+
+#include <bit>
+#include <cstring>
+
+namespace dconstruct::reloc {
+    enum class Kernel : u8 {
+        SCALAR,
+        AVX2,
+        AVX512,
+    };
+
+    // reads the 8 bitmap bytes starting at byte i as one little endian word, the tail is zero filled
+    [[nodiscard]] inline u64 load_word(const u8* bitmap, const u64 bitmap_size, const u64 i) noexcept {
+        u64 word = 0;
+        std::memcpy(&word, bitmap + i, bitmap_size - i < sizeof(word) ? bitmap_size - i : sizeof(word));
+        return word;
+    }
+
+    // calls func with the index of every set bit in bitmap, in ascending order.
+    // zero words are skipped as a whole, so the cost scales with the number of set bits.
+    template<typename Func>
+    inline void for_each_set_bit(const u8* bitmap, const u64 bitmap_size, Func&& func) {
+        for (u64 i = 0; i < bitmap_size; i += sizeof(u64)) {
+            for (u64 word = load_word(bitmap, bitmap_size, i); word != 0; word &= word - 1) {
+                func(i * 8 + std::countr_zero(word));
+            }
+        }
+    }
+
+    // clears the lowest non-zero byte of word, stores it in byte and returns its position within the word.
+    // word must not be 0.
+    [[nodiscard]] inline u32 pop_set_byte(u64& word, u8& byte) noexcept {
+        const u32 shift = std::countr_zero(word) & ~7u;
+        byte = static_cast<u8>(word >> shift);
+        word &= ~(u64{0xFF} << shift);
+        return shift / 8;
+    }
+
+    // adds delta to every 8-byte slot of image whose bit is set in bitmap. a delta of 0 leaves the image untouched.
+    // if pointed_at isn't null, the bit of every slot that one of the (original) pointers points at gets set in it.
+    // pointed_at has to be bitmap_size bytes large.
+    void apply(std::byte* image, const u8* bitmap, const u64 bitmap_size, const p64 delta, u8* pointed_at) noexcept;
+
+    // the kernel apply() picked for this cpu
+    [[nodiscard]] Kernel active_kernel() noexcept;
+    [[nodiscard]] const char* kernel_name(const Kernel kernel) noexcept;
+}
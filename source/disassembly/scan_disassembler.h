@@ -0,0 +1,24 @@
+#pragma once
+
+#include "disassembler.h"
+
+
+namespace dconstruct {
+    // runs the disassembly without producing any output, for whatever only needs what it finds out about the file,
+    // like the sids that the file looks up
+    class ScanDisassembler : public Disassembler {
+
+    public:
+        ScanDisassembler(BinaryFile* file, const SIDBase* sidbase, const DisassemblerOptions& options) {
+            m_currentFile = file;
+            m_sidbase = sidbase;
+            m_options = options;
+            m_discardText = true;
+        }
+
+    private:
+        void insert_span(const char* text, const u32 indent = 0, const TextFormat& text_format = TextFormat{}) override {}
+
+        void complete() override {}
+    };
+}
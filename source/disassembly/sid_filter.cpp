@@ -0,0 +1,21 @@
+#include "sid_filter.h"
+#include "sidbase.h"
+
+#include <algorithm>
+
+namespace dconstruct {
+    void SidFilter::build(std::span<const SIDBaseEntry> entries) {
+        constexpr u64 bits_per_block = sizeof(Block) * 8;
+        const u64 num_blocks = std::clamp<u64>((entries.size() * BITS_PER_SID + bits_per_block - 1) / bits_per_block, 1, 0xFFFFFFFFULL);
+
+        m_ownedBlocks.assign(num_blocks, Block{});
+        for (const SIDBaseEntry& entry : entries) {
+            const u64 h = mix64(entry.hash);
+            Block& block = m_ownedBlocks[block_of(h, num_blocks)];
+            for (u32 i = 0; i < 8; ++i) {
+                block.m_words[i] |= bit_of(h, i);
+            }
+        }
+        m_blocks = m_ownedBlocks;
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "base.h"
+#include "hash.h"
+#include <span>
+#include <vector>
+
+namespace dconstruct {
+    struct SIDBaseEntry;
+
+    /*
+        split block bloom filter over the hashes of a sidbase. every sid sets one bit in each of the 8 words of a
+        single 32 byte block, so asking whether a value could be a sid is one memory access, and with 16 bits
+        per sid fewer than 1 in 200 values that aren't sids get through to the real search.
+    */
+    class SidFilter {
+    public:
+        struct alignas(32) Block {
+            u32 m_words[8];
+        };
+
+        static constexpr u64 BITS_PER_SID = 16;
+
+        void build(std::span<const SIDBaseEntry> entries);
+
+        // uses blocks owned by someone else, like a mapped sidecar
+        void adopt(std::span<const Block> blocks) noexcept {
+            m_ownedBlocks.clear();
+            m_blocks = blocks;
+        }
+
+        [[nodiscard]] b8 is_built() const noexcept {
+            return !m_blocks.empty();
+        }
+
+        [[nodiscard]] std::span<const Block> blocks() const noexcept {
+            return m_blocks;
+        }
+
+        // false means hash is definitely not in the sidbase
+        [[nodiscard]] b8 may_contain(const sid64 hash) const noexcept {
+            const u64 h = mix64(hash);
+            const Block& block = m_blocks[block_of(h, m_blocks.size())];
+            for (u32 i = 0; i < 8; ++i) {
+                if ((block.m_words[i] & bit_of(h, i)) == 0) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+    private:
+        std::vector<Block> m_ownedBlocks;
+        std::span<const Block> m_blocks;
+
+        [[nodiscard]] static u64 block_of(const u64 h, const u64 num_blocks) noexcept {
+            return ((h >> 32) * num_blocks) >> 32;
+        }
+
+        [[nodiscard]] static u32 bit_of(const u64 h, const u32 word) noexcept {
+            constexpr u32 salts[8] = { 0x47B6137B, 0x44974D91, 0x8824AD5B, 0xA2B7289D, 0x705495C7, 0x2DF1424B, 0x9EFC4947, 0x5C6BFB31 };
+            return u32{1} << ((static_cast<u32>(h) * salts[word]) >> 27);
+        }
+    };
+}
@@ -0,0 +1,280 @@
+#include "sid_mph.h"
+#include "sidbase.h"
+#include "hash.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace dconstruct {
+    static constexpr u32 SID_MPH_MAGIC = 0x48504D53; // "SMPH"
+    static constexpr u32 SID_MPH_VERSION = 2;
+
+    // average number of keys per bucket, and how full the table gets before the overflow is remapped
+    static constexpr u64 KEYS_PER_BUCKET = 4;
+    static constexpr u64 LOAD_FACTOR_PERCENT = 98;
+    static constexpr u32 MAX_PILOT = 1 << 22;
+    static constexpr u32 MAX_SEEDS = 16;
+
+    [[nodiscard]] static u64 key_hash(const sid64 sid, const u64 seed) noexcept {
+        return mix64(sid ^ seed);
+    }
+
+    [[nodiscard]] static u64 bucket_of(const u64 key_hash, const u64 num_buckets) noexcept {
+        return ((key_hash >> 32) * num_buckets) >> 32;
+    }
+
+    [[nodiscard]] static u64 position_of(const u64 key_hash, const u32 pilot, const u64 table_size) noexcept {
+        return (key_hash ^ mix64(pilot)) % table_size;
+    }
+
+    [[nodiscard]] static u64 align_up(const u64 value) noexcept {
+        return (value + 7) & ~u64{7};
+    }
+
+    [[nodiscard]] b8 SidPerfectHash::open(const std::filesystem::path& path, const u64 fingerprint) noexcept {
+        if (!m_mapping.open(path, MapAccess::READ_ONLY)) {
+            return false;
+        }
+
+        const u64 size = m_mapping.size();
+        const SidMphHeader* header = reinterpret_cast<const SidMphHeader*>(m_mapping.data());
+        const b8 valid = size >= sizeof(SidMphHeader) &&
+            header->m_magic == SID_MPH_MAGIC && header->m_version == SID_MPH_VERSION &&
+            header->m_fingerprint == fingerprint &&
+            header->m_numKeys != 0 && header->m_numKeys <= header->m_tableSize && header->m_tableSize <= 0xFFFFFFFFULL &&
+            header->m_numBuckets != 0 && header->m_numBuckets <= 0xFFFFFFFFULL &&
+            header->m_pilotsOffset % 4 == 0 && header->m_remapOffset % 4 == 0 && header->m_slotsOffset % 8 == 0 &&
+            header->m_pilotsOffset <= size && header->m_numBuckets <= (size - header->m_pilotsOffset) / sizeof(u32) &&
+            header->m_remapOffset <= size && header->m_tableSize - header->m_numKeys <= (size - header->m_remapOffset) / sizeof(u32) &&
+            header->m_slotsOffset <= size && header->m_numKeys <= (size - header->m_slotsOffset) / sizeof(SIDBaseEntry) &&
+            header->m_filterOffset % alignof(SidFilter::Block) == 0 && header->m_numFilterBlocks != 0 &&
+            header->m_filterOffset <= size && header->m_numFilterBlocks <= (size - header->m_filterOffset) / sizeof(SidFilter::Block);
+        if (!valid) {
+            m_mapping.close();
+            return false;
+        }
+
+        m_seed = header->m_seed;
+        m_numKeys = header->m_numKeys;
+        m_tableSize = header->m_tableSize;
+        m_numBuckets = header->m_numBuckets;
+        m_pilots = reinterpret_cast<const u32*>(m_mapping.data() + header->m_pilotsOffset);
+        m_remap = reinterpret_cast<const u32*>(m_mapping.data() + header->m_remapOffset);
+        m_slots = reinterpret_cast<const SIDBaseEntry*>(m_mapping.data() + header->m_slotsOffset);
+        m_filterBlocks = { reinterpret_cast<const SidFilter::Block*>(m_mapping.data() + header->m_filterOffset), header->m_numFilterBlocks };
+        return true;
+    }
+
+    [[nodiscard]] const SIDBaseEntry* SidPerfectHash::find(const sid64 hash) const noexcept {
+        const u64 h = key_hash(hash, m_seed);
+        u64 slot = position_of(h, m_pilots[bucket_of(h, m_numBuckets)], m_tableSize);
+        if (slot >= m_numKeys) [[unlikely]] {
+            slot = m_remap[slot - m_numKeys];
+            if (slot >= m_numKeys) {
+                return nullptr;
+            }
+        }
+        const SIDBaseEntry* entry = m_slots + slot;
+        return entry->hash == hash ? entry : nullptr;
+    }
+
+    [[nodiscard]] std::filesystem::path sid_mph_path(const std::filesystem::path& sidbase_path) {
+        std::filesystem::path path = sidbase_path;
+        path += ".mph";
+        return path;
+    }
+
+    // finds a pilot for every bucket. fails if some bucket can't be placed with this seed.
+    [[nodiscard]] static b8 place_buckets(
+        const std::vector<u64>& hashes,
+        const u64 table_size,
+        const u64 num_buckets,
+        std::vector<u32>& pilots,
+        std::vector<u64>& positions) {
+
+        std::vector<u64> bucket_start(num_buckets + 1, 0);
+        for (const u64 h : hashes) {
+            ++bucket_start[bucket_of(h, num_buckets) + 1];
+        }
+        u64 max_bucket_size = 0;
+        for (u64 i = 0; i < num_buckets; ++i) {
+            max_bucket_size = std::max(max_bucket_size, bucket_start[i + 1]);
+            bucket_start[i + 1] += bucket_start[i];
+        }
+        std::vector<u64> keys_by_bucket(hashes.size());
+        {
+            std::vector<u64> fill(bucket_start.begin(), bucket_start.end() - 1);
+            for (u64 i = 0; i < hashes.size(); ++i) {
+                keys_by_bucket[fill[bucket_of(hashes[i], num_buckets)]++] = i;
+            }
+        }
+
+        // largest buckets first, while the table is still empty enough to place them easily
+        std::vector<u64> order(num_buckets);
+        {
+            std::vector<u64> size_start(max_bucket_size + 2, 0);
+            for (u64 b = 0; b < num_buckets; ++b) {
+                ++size_start[max_bucket_size - (bucket_start[b + 1] - bucket_start[b]) + 1];
+            }
+            for (u64 i = 0; i <= max_bucket_size; ++i) {
+                size_start[i + 1] += size_start[i];
+            }
+            for (u64 b = 0; b < num_buckets; ++b) {
+                order[size_start[max_bucket_size - (bucket_start[b + 1] - bucket_start[b])]++] = b;
+            }
+        }
+
+        std::vector<u64> taken((table_size + 63) / 64, 0);
+        const auto is_taken = [&taken](const u64 pos) { return (taken[pos / 64] >> (pos % 64)) & 1; };
+        std::vector<u64> candidate;
+        pilots.assign(num_buckets, 0);
+        positions.assign(hashes.size(), 0);
+
+        for (const u64 bucket : order) {
+            const u64 first = bucket_start[bucket];
+            const u64 count = bucket_start[bucket + 1] - first;
+            if (count == 0) {
+                break;
+            }
+
+            u32 pilot = 0;
+            for (; pilot < MAX_PILOT; ++pilot) {
+                candidate.clear();
+                b8 fits = true;
+                for (u64 i = 0; i < count && fits; ++i) {
+                    const u64 pos = position_of(hashes[keys_by_bucket[first + i]], pilot, table_size);
+                    fits = !is_taken(pos) && std::find(candidate.begin(), candidate.end(), pos) == candidate.end();
+                    candidate.push_back(pos);
+                }
+                if (fits) {
+                    break;
+                }
+            }
+            if (pilot == MAX_PILOT) {
+                return false;
+            }
+
+            pilots[bucket] = pilot;
+            for (u64 i = 0; i < count; ++i) {
+                taken[candidate[i] / 64] |= u64{1} << (candidate[i] % 64);
+                positions[keys_by_bucket[first + i]] = candidate[i];
+            }
+        }
+        return true;
+    }
+
+    [[nodiscard]] b8 write_sid_mph(const std::filesystem::path& path, std::span<const SIDBaseEntry> entries, const u64 fingerprint) {
+        // the entries are sorted, so duplicates are next to each other
+        std::vector<SIDBaseEntry> keys;
+        keys.reserve(entries.size());
+        for (const SIDBaseEntry& entry : entries) {
+            if (keys.empty() || keys.back().hash != entry.hash) {
+                keys.push_back(entry);
+            }
+        }
+        if (keys.empty() || keys.size() > 0xFFFFFFFFULL / 2) {
+            std::cout << "error: can't build a perfect hash over " << keys.size() << " sids\n";
+            return false;
+        }
+
+        const u64 num_keys = keys.size();
+        const u64 table_size = std::max(num_keys, (num_keys * 100 + LOAD_FACTOR_PERCENT - 1) / LOAD_FACTOR_PERCENT);
+        const u64 num_buckets = (num_keys + KEYS_PER_BUCKET - 1) / KEYS_PER_BUCKET;
+
+        std::vector<u64> hashes(num_keys);
+        std::vector<u32> pilots;
+        std::vector<u64> positions;
+        u64 seed = 0;
+        b8 placed = false;
+        for (u32 attempt = 0; attempt < MAX_SEEDS && !placed; ++attempt) {
+            seed = mix64(0x5EED0000ULL + attempt);
+            for (u64 i = 0; i < num_keys; ++i) {
+                hashes[i] = key_hash(keys[i].hash, seed);
+            }
+            placed = place_buckets(hashes, table_size, num_buckets, pilots, positions);
+        }
+        if (!placed) {
+            std::cout << "error: couldn't find a perfect hash for the sidbase\n";
+            return false;
+        }
+
+        // slots past num_keys are moved into the holes below it, so the slot array has no gaps
+        std::vector<u8> used(num_keys, 0);
+        std::vector<u32> remap(table_size - num_keys, 0xFFFFFFFF);
+        for (const u64 pos : positions) {
+            if (pos < num_keys) {
+                used[pos] = 1;
+            }
+        }
+        u64 next_hole = 0;
+        for (u64& pos : positions) {
+            if (pos < num_keys) {
+                continue;
+            }
+            while (used[next_hole]) {
+                ++next_hole;
+            }
+            used[next_hole] = 1;
+            remap[pos - num_keys] = static_cast<u32>(next_hole);
+            pos = next_hole;
+        }
+
+        std::vector<SIDBaseEntry> slots(num_keys);
+        for (u64 i = 0; i < num_keys; ++i) {
+            slots[positions[i]] = keys[i];
+        }
+
+        SidFilter filter;
+        filter.build(keys);
+
+        SidMphHeader header{};
+        header.m_magic = SID_MPH_MAGIC;
+        header.m_version = SID_MPH_VERSION;
+        header.m_fingerprint = fingerprint;
+        header.m_seed = seed;
+        header.m_numKeys = num_keys;
+        header.m_tableSize = table_size;
+        header.m_numBuckets = num_buckets;
+        header.m_pilotsOffset = sizeof(SidMphHeader);
+        header.m_remapOffset = header.m_pilotsOffset + num_buckets * sizeof(u32);
+        header.m_slotsOffset = align_up(header.m_remapOffset + remap.size() * sizeof(u32));
+        header.m_numFilterBlocks = filter.blocks().size();
+        header.m_filterOffset = (header.m_slotsOffset + num_keys * sizeof(SIDBaseEntry) + alignof(SidFilter::Block) - 1) / alignof(SidFilter::Block) * alignof(SidFilter::Block);
+
+        std::filesystem::path temp_path = path;
+        temp_path += ".tmp";
+        {
+            std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+            if (!out.is_open()) {
+                std::cout << "error: couldn't open " << temp_path << " for writing\n";
+                return false;
+            }
+            constexpr char padding[alignof(SidFilter::Block)] = {};
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(reinterpret_cast<const char*>(pilots.data()), pilots.size() * sizeof(u32));
+            out.write(reinterpret_cast<const char*>(remap.data()), remap.size() * sizeof(u32));
+            out.write(padding, header.m_slotsOffset - out.tellp());
+            out.write(reinterpret_cast<const char*>(slots.data()), slots.size() * sizeof(SIDBaseEntry));
+            out.write(padding, header.m_filterOffset - out.tellp());
+            out.write(reinterpret_cast<const char*>(filter.blocks().data()), filter.blocks().size_bytes());
+            if (!out.good()) {
+                out.close();
+                std::error_code ec;
+                std::filesystem::remove(temp_path, ec);
+                std::cout << "error: couldn't write " << path << '\n';
+                return false;
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(temp_path, path, ec);
+        if (ec) {
+            std::filesystem::remove(temp_path, ec);
+            std::cout << "error: couldn't write " << path << '\n';
+            return false;
+        }
+        return true;
+    }
+}
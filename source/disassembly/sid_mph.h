@@ -0,0 +1,73 @@
+#pragma once
+
+#include "base.h"
+#include "mapped_file.h"
+#include "sid_filter.h"
+#include <filesystem>
+#include <span>
+
+namespace dconstruct {
+    struct SIDBaseEntry;
+
+    /*
+        minimal perfect hash over the hashes of a sidbase, stored in a sidecar next to it. every sid of the sidbase
+        maps to its own slot in [0, m_numKeys), so a lookup reads one pilot, one slot and compares the hash.
+        built PTHash style: keys are split into buckets, and every bucket gets the first pilot that moves all of
+        its keys into free slots of a table slightly larger than the number of keys. slots past the end are
+        remapped into the holes that are left over.
+
+        SidMphHeader
+        u32 pilots[m_numBuckets]
+        u32 remap[m_tableSize - m_numKeys]
+        SIDBaseEntry slots[m_numKeys]       the sidbase entries, in slot order
+        SidFilter::Block filter[m_numFilterBlocks]  32 byte aligned
+    */
+    struct SidMphHeader {
+        u32 m_magic;
+        u32 m_version;
+        u64 m_fingerprint;
+        u64 m_seed;
+        u64 m_numKeys;
+        u64 m_tableSize;
+        u64 m_numBuckets;
+        u64 m_pilotsOffset;
+        u64 m_remapOffset;
+        u64 m_slotsOffset;
+        u64 m_filterOffset;
+        u64 m_numFilterBlocks;
+    };
+
+    class SidPerfectHash {
+    public:
+        // maps the sidecar at path if it was built for a sidbase with this fingerprint
+        [[nodiscard]] b8 open(const std::filesystem::path& path, const u64 fingerprint) noexcept;
+
+        [[nodiscard]] b8 is_open() const noexcept {
+            return m_mapping.is_open();
+        }
+
+        // the entry for hash, or nullptr if the sidbase doesn't contain it
+        [[nodiscard]] const SIDBaseEntry* find(const sid64 hash) const noexcept;
+
+        // the prefilter that was built along with the perfect hash
+        [[nodiscard]] std::span<const SidFilter::Block> filter_blocks() const noexcept {
+            return m_filterBlocks;
+        }
+
+    private:
+        MappedFile m_mapping;
+        u64 m_seed = 0;
+        u64 m_numKeys = 0;
+        u64 m_tableSize = 0;
+        u64 m_numBuckets = 0;
+        const u32* m_pilots = nullptr;
+        const u32* m_remap = nullptr;
+        const SIDBaseEntry* m_slots = nullptr;
+        std::span<const SidFilter::Block> m_filterBlocks;
+    };
+
+    [[nodiscard]] std::filesystem::path sid_mph_path(const std::filesystem::path& sidbase_path);
+
+    // builds the perfect hash over entries (sorted by hash) and writes it to path. duplicate hashes keep the first entry.
+    [[nodiscard]] b8 write_sid_mph(const std::filesystem::path& path, std::span<const SIDBaseEntry> entries, const u64 fingerprint);
+}
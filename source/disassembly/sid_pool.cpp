@@ -0,0 +1,266 @@
+#include "sid_pool.h"
+#include "sidbase.h"
+#include "sidbase_builder.h"
+#include "radix_sort.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string_view>
+
+namespace dconstruct {
+    static constexpr u32 SID_POOL_MAGIC = 0x5A444953; // "SIDZ"
+    static constexpr u32 SID_POOL_VERSION = 1;
+
+    struct CachedBlock {
+        u64 m_poolId = 0;   // 0 if the slot is empty
+        u64 m_block = 0;
+        std::vector<char> m_bytes;
+    };
+
+    struct BlockCache {
+        std::array<CachedBlock, SID_POOL_CACHED_BLOCKS> m_slots;
+        u64 m_next = 0;
+    };
+
+    // every pool gets its own id, so a pool that's opened where an old one used to be never finds its blocks
+    static std::atomic<u64> next_pool_id{1};
+    static thread_local BlockCache block_cache;
+
+    static void write_varint(std::vector<u8>& out, u64 value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<u8>(value) | 0x80);
+            value >>= 7;
+        }
+        out.push_back(static_cast<u8>(value));
+    }
+
+    [[nodiscard]] static b8 read_varint(const u8*& pos, const u8* end, u64& value) noexcept {
+        value = 0;
+        for (u32 shift = 0; shift < 64 && pos < end; shift += 7) {
+            const u8 byte = *pos++;
+            value |= static_cast<u64>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    [[nodiscard]] b8 is_sid_pool(const std::byte* bytes, const u64 size) noexcept {
+        if (size < sizeof(SidPoolHeader)) {
+            return false;
+        }
+        u32 magic = 0;
+        std::memcpy(&magic, bytes, sizeof(magic));
+        return magic == SID_POOL_MAGIC;
+    }
+
+    [[nodiscard]] b8 SidStringPool::open(const std::byte* bytes, const u64 size) noexcept {
+        if (!is_sid_pool(bytes, size)) {
+            return false;
+        }
+        const SidPoolHeader* header = reinterpret_cast<const SidPoolHeader*>(bytes);
+        const b8 valid = header->m_version == SID_POOL_VERSION &&
+            header->m_numEntries != 0 && header->m_numBlocks != 0 &&
+            header->m_entriesOffset % 8 == 0 && header->m_blocksOffset % 8 == 0 &&
+            header->m_entriesOffset <= size && header->m_numEntries <= (size - header->m_entriesOffset) / sizeof(SIDBaseEntry) &&
+            header->m_blocksOffset <= size && header->m_numBlocks <= (size - header->m_blocksOffset) / sizeof(SidPoolBlock) &&
+            header->m_dataOffset <= size && header->m_dataSize <= size - header->m_dataOffset;
+        if (!valid) {
+            return false;
+        }
+
+        const SidPoolBlock* blocks = reinterpret_cast<const SidPoolBlock*>(bytes + header->m_blocksOffset);
+        for (u64 i = 0; i < header->m_numBlocks; ++i) {
+            const u64 data_end = i + 1 < header->m_numBlocks ? blocks[i + 1].m_dataOffset : header->m_dataSize;
+            if (blocks[i].m_dataOffset >= data_end || data_end > header->m_dataSize || blocks[i].m_decodedSize > 0xFFFFFFFFULL) {
+                return false;
+            }
+        }
+
+        m_id = next_pool_id.fetch_add(1, std::memory_order_relaxed);
+        m_numEntries = header->m_numEntries;
+        m_numBlocks = header->m_numBlocks;
+        m_dataSize = header->m_dataSize;
+        m_entries = reinterpret_cast<const SIDBaseEntry*>(bytes + header->m_entriesOffset);
+        m_blocks = blocks;
+        m_data = reinterpret_cast<const u8*>(bytes + header->m_dataOffset);
+        return true;
+    }
+
+    [[nodiscard]] std::span<const SIDBaseEntry> SidStringPool::entries() const noexcept {
+        return { m_entries, m_numEntries };
+    }
+
+    [[nodiscard]] b8 SidStringPool::decode_block(const u64 block, std::vector<char>& out) const {
+        const u64 decoded_size = m_blocks[block].m_decodedSize;
+        const u8* pos = m_data + m_blocks[block].m_dataOffset;
+        const u8* const end = m_data + (block + 1 < m_numBlocks ? m_blocks[block + 1].m_dataOffset : m_dataSize);
+
+        out.clear();
+        out.reserve(decoded_size);
+        u64 previous_start = 0;
+        u64 previous_length = 0;
+        while (pos < end) {
+            u64 shared = 0;
+            u64 suffix = 0;
+            if (!out.empty() && !read_varint(pos, end, shared)) {
+                return false;
+            }
+            if (!read_varint(pos, end, suffix) || shared > previous_length || suffix > static_cast<u64>(end - pos) ||
+                out.size() + shared + suffix + 1 > decoded_size) {
+                return false;
+            }
+            const u64 start = out.size();
+            out.resize(start + shared + suffix + 1);
+            std::memmove(out.data() + start, out.data() + previous_start, shared);
+            std::memcpy(out.data() + start + shared, pos, suffix);
+            out.back() = '\0';
+            pos += suffix;
+            previous_start = start;
+            previous_length = shared + suffix;
+        }
+        return out.size() == decoded_size;
+    }
+
+    [[nodiscard]] const char* SidStringPool::string_at(const u64 offset) const noexcept {
+        const u64 block = offset >> 32;
+        const u64 position = offset & 0xFFFFFFFF;
+        if (block >= m_numBlocks || position >= m_blocks[block].m_decodedSize) {
+            return "";
+        }
+
+        for (const CachedBlock& cached : block_cache.m_slots) {
+            if (cached.m_poolId == m_id && cached.m_block == block) {
+                return cached.m_bytes.data() + position;
+            }
+        }
+
+        CachedBlock& slot = block_cache.m_slots[block_cache.m_next++ % SID_POOL_CACHED_BLOCKS];
+        slot.m_poolId = 0;
+        if (!decode_block(block, slot.m_bytes)) {
+            return "";
+        }
+        slot.m_poolId = m_id;
+        slot.m_block = block;
+        return slot.m_bytes.data() + position;
+    }
+
+    [[nodiscard]] b8 SidStringPool::owns(const char* str) const noexcept {
+        for (const CachedBlock& cached : block_cache.m_slots) {
+            if (cached.m_poolId == m_id && str >= cached.m_bytes.data() && str < cached.m_bytes.data() + cached.m_bytes.size()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    [[nodiscard]] u64 SidStringPool::offset_of(const char* str) const noexcept {
+        for (const CachedBlock& cached : block_cache.m_slots) {
+            if (cached.m_poolId == m_id && str >= cached.m_bytes.data() && str < cached.m_bytes.data() + cached.m_bytes.size()) {
+                return (cached.m_block << 32) | static_cast<u64>(str - cached.m_bytes.data());
+            }
+        }
+        return SID_NO_OFFSET;
+    }
+
+    void SidStringPool::decode_all(std::vector<char>& pool, std::vector<SIDBaseEntry>& records) const {
+        std::vector<u64> block_starts(m_numBlocks);
+        std::vector<char> block_bytes;
+        for (u64 block = 0; block < m_numBlocks; ++block) {
+            if (!decode_block(block, block_bytes)) {
+                block_bytes.assign(m_blocks[block].m_decodedSize, '\0');
+            }
+            block_starts[block] = pool.size();
+            pool.insert(pool.end(), block_bytes.begin(), block_bytes.end());
+        }
+        records.reserve(records.size() + m_numEntries);
+        for (u64 i = 0; i < m_numEntries; ++i) {
+            const u64 block = m_entries[i].offset >> 32;
+            const u64 position = m_entries[i].offset & 0xFFFFFFFF;
+            if (block < m_numBlocks && position < m_blocks[block].m_decodedSize) {
+                records.push_back(SIDBaseEntry{ m_entries[i].hash, block_starts[block] + position });
+            }
+        }
+    }
+
+    [[nodiscard]] b8 write_sid_pool(const std::filesystem::path& path, std::span<const SIDBaseEntry> entries, const char* strings) {
+        const u64 num_entries = entries.size();
+        std::vector<SIDBaseEntry> out_entries(entries.begin(), entries.end());
+        sort_by_string(out_entries, strings);
+
+        std::vector<SidPoolBlock> blocks;
+        std::vector<u8> data;
+        std::string_view previous;
+        for (u64 i = 0; i < num_entries; ++i) {
+            const std::string_view str = strings + out_entries[i].offset;
+            u64 shared = 0;
+            if (i % SID_POOL_BLOCK_SIZE == 0) {
+                blocks.push_back(SidPoolBlock{ data.size(), 0 });
+            } else {
+                const u64 max_shared = std::min(previous.size(), str.size());
+                while (shared < max_shared && previous[shared] == str[shared]) {
+                    ++shared;
+                }
+                write_varint(data, shared);
+            }
+            write_varint(data, str.size() - shared);
+            data.insert(data.end(), str.begin() + shared, str.end());
+
+            SidPoolBlock& block = blocks.back();
+            if (block.m_decodedSize + str.size() + 1 > 0xFFFFFFFFULL) {
+                std::cout << "error: the strings are too long to be compressed\n";
+                return false;
+            }
+            out_entries[i].offset = ((blocks.size() - 1) << 32) | block.m_decodedSize;
+            block.m_decodedSize += str.size() + 1;
+            previous = str;
+        }
+        // back into hash order
+        parallel_radix_sort(out_entries, [](const SIDBaseEntry& entry) { return entry.hash; });
+
+        SidPoolHeader header{};
+        header.m_magic = SID_POOL_MAGIC;
+        header.m_version = SID_POOL_VERSION;
+        header.m_numEntries = num_entries;
+        header.m_numBlocks = blocks.size();
+        header.m_entriesOffset = sizeof(SidPoolHeader);
+        header.m_blocksOffset = header.m_entriesOffset + num_entries * sizeof(SIDBaseEntry);
+        header.m_dataOffset = header.m_blocksOffset + blocks.size() * sizeof(SidPoolBlock);
+        header.m_dataSize = data.size();
+
+        std::filesystem::path temp_path = path;
+        temp_path += ".tmp";
+        {
+            std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+            if (!out.is_open()) {
+                std::cout << "error: couldn't open " << temp_path << " for writing\n";
+                return false;
+            }
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(reinterpret_cast<const char*>(out_entries.data()), out_entries.size() * sizeof(SIDBaseEntry));
+            out.write(reinterpret_cast<const char*>(blocks.data()), blocks.size() * sizeof(SidPoolBlock));
+            out.write(reinterpret_cast<const char*>(data.data()), data.size());
+            if (!out.good()) {
+                out.close();
+                std::error_code ec;
+                std::filesystem::remove(temp_path, ec);
+                std::cout << "error: couldn't write " << path << '\n';
+                return false;
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(temp_path, path, ec);
+        if (ec) {
+            std::filesystem::remove(temp_path, ec);
+            std::cout << "error: couldn't write " << path << '\n';
+            return false;
+        }
+        return true;
+    }
+}
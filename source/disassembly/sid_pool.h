@@ -0,0 +1,91 @@
+#pragma once
+
+#include "base.h"
+#include <filesystem>
+#include <span>
+#include <vector>
+
+namespace dconstruct {
+    struct SIDBaseEntry;
+
+    // returned by the offset_of() functions for strings they don't own
+    inline constexpr u64 SID_NO_OFFSET = 0xFFFFFFFFFFFFFFFF;
+
+    /*
+        sidbase with a front coded string pool. the strings are stored sorted, so neighbours mostly share long
+        prefixes, and every block of SID_POOL_BLOCK_SIZE strings stores its first string in full and every other
+        string as the length of the prefix it shares with the one before plus the rest of it.
+        the offset of an entry holds the number of the block with its string in the upper 32 bits and where the
+        string starts in the decoded block in the lower 32, so they still order the same way the strings do.
+        a lookup decodes only that block, into a small cache owned by the calling thread.
+
+        SidPoolHeader
+        SIDBaseEntry entries[m_numEntries]      sorted by hash
+        SidPoolBlock blocks[m_numBlocks]
+        u8 data[m_dataSize]                     the encoded blocks, one after another
+    */
+    struct SidPoolHeader {
+        u32 m_magic;
+        u32 m_version;
+        u64 m_numEntries;
+        u64 m_numBlocks;
+        u64 m_entriesOffset;
+        u64 m_blocksOffset;
+        u64 m_dataOffset;
+        u64 m_dataSize;
+    };
+
+    struct SidPoolBlock {
+        u64 m_dataOffset;   // where the block starts in data
+        u64 m_decodedSize;  // size of the block's strings once decoded, including their terminators
+    };
+
+    static constexpr u64 SID_POOL_BLOCK_SIZE = 16;
+    // blocks every thread keeps decoded
+    static constexpr u64 SID_POOL_CACHED_BLOCKS = 8;
+
+    [[nodiscard]] b8 is_sid_pool(const std::byte* bytes, const u64 size) noexcept;
+
+    class SidStringPool {
+    public:
+        // uses the pool in bytes, which has to outlive this
+        [[nodiscard]] b8 open(const std::byte* bytes, const u64 size) noexcept;
+
+        [[nodiscard]] b8 is_open() const noexcept {
+            return m_blocks != nullptr;
+        }
+
+        [[nodiscard]] std::span<const SIDBaseEntry> entries() const noexcept;
+
+        // offsets of strings are in [0, offset_range())
+        [[nodiscard]] u64 offset_range() const noexcept {
+            return m_numBlocks << 32;
+        }
+
+        // the string at offset. it lives in the calling thread's block cache, and stays valid
+        // until the thread has decoded SID_POOL_CACHED_BLOCKS more blocks.
+        [[nodiscard]] const char* string_at(const u64 offset) const noexcept;
+
+        // whether str was returned by string_at() on this thread and is still cached
+        [[nodiscard]] b8 owns(const char* str) const noexcept;
+        // SID_NO_OFFSET once str's block was evicted from the cache
+        [[nodiscard]] u64 offset_of(const char* str) const noexcept;
+
+        // decodes every string into pool and appends the entries, with their offsets changed to point into pool
+        void decode_all(std::vector<char>& pool, std::vector<SIDBaseEntry>& records) const;
+
+    private:
+        u64 m_id = 0;
+        u64 m_numEntries = 0;
+        u64 m_numBlocks = 0;
+        u64 m_dataSize = 0;
+        const SIDBaseEntry* m_entries = nullptr;
+        const SidPoolBlock* m_blocks = nullptr;
+        const u8* m_data = nullptr;
+
+        [[nodiscard]] b8 decode_block(const u64 block, std::vector<char>& out) const;
+    };
+
+    // writes entries (sorted by hash, offsets into strings) as a sidbase with a front coded pool
+    [[nodiscard]] b8 write_sid_pool(const std::filesystem::path& path, std::span<const SIDBaseEntry> entries, const char* strings);
+}
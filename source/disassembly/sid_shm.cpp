@@ -0,0 +1,169 @@
+#include "sid_shm.h"
+#include "sid_filter.h"
+#include "sidbase.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace dconstruct {
+    static constexpr u32 SID_SHM_MAGIC = 0x4D485353; // "SSHM"
+    static constexpr u32 SID_SHM_VERSION = 1;
+    // how long attach() waits for another process to finish publishing before it gives up on the segment
+    static constexpr std::chrono::seconds PUBLISH_TIMEOUT{10};
+
+    [[nodiscard]] static std::string segment_name(const u64 key) {
+        char name[64];
+        std::snprintf(name, sizeof(name), "/dconstruct-sidbase-v%u-%016llX", SID_SHM_VERSION, static_cast<unsigned long long>(key));
+        return name;
+    }
+
+    SidSharedSegment::~SidSharedSegment() {
+        // a segment that was created but never published is useless to everyone else
+        abandon();
+    }
+
+#ifdef _WIN32
+    [[nodiscard]] b8 SidSharedSegment::is_supported() noexcept {
+        return false;
+    }
+
+    [[nodiscard]] b8 SidSharedSegment::attach(const u64, const u64) noexcept {
+        return false;
+    }
+
+    [[nodiscard]] std::byte* SidSharedSegment::create(const SidShmHeader&) noexcept {
+        return nullptr;
+    }
+
+    void SidSharedSegment::publish() noexcept {}
+
+    void SidSharedSegment::abandon() noexcept {}
+
+    void SidSharedSegment::close() noexcept {}
+#else
+    [[nodiscard]] b8 SidSharedSegment::is_supported() noexcept {
+        return true;
+    }
+
+    [[nodiscard]] b8 SidSharedSegment::attach(const u64 key, const u64 num_entries) noexcept {
+        close();
+        const std::string name = segment_name(key);
+        const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0) {
+            return false;
+        }
+
+        // the publisher sizes the segment right after creating it, and sets m_ready last. if either doesn't happen
+        // in time, whoever created it died before finishing it, so it's removed for the next process to publish again.
+        const auto deadline = std::chrono::steady_clock::now() + PUBLISH_TIMEOUT;
+        struct stat st;
+        while (fstat(fd, &st) == 0 && static_cast<u64>(st.st_size) < sizeof(SidShmHeader) && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if (fstat(fd, &st) != 0 || static_cast<u64>(st.st_size) < sizeof(SidShmHeader)) {
+            ::close(fd);
+            shm_unlink(name.c_str());
+            return false;
+        }
+
+        const u64 size = st.st_size;
+        void* view = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (view == MAP_FAILED) {
+            return false;
+        }
+        const SidShmHeader* header = reinterpret_cast<const SidShmHeader*>(view);
+        while (__atomic_load_n(&header->m_ready, __ATOMIC_ACQUIRE) == 0 && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if (__atomic_load_n(&header->m_ready, __ATOMIC_ACQUIRE) == 0) {
+            munmap(view, size);
+            shm_unlink(name.c_str());
+            return false;
+        }
+
+        const u64 tree_size = (num_entries + 1) * sizeof(sid64);
+        const b8 valid = header->m_magic == SID_SHM_MAGIC && header->m_version == SID_SHM_VERSION &&
+            header->m_key == key && header->m_numEntries == num_entries && header->m_size == size &&
+            header->m_treeOffset % 64 == 0 && header->m_treeOffset <= size && tree_size <= size - header->m_treeOffset &&
+            header->m_treeOffsetsOffset % 8 == 0 && header->m_treeOffsetsOffset <= size && tree_size <= size - header->m_treeOffsetsOffset &&
+            header->m_filterOffset % alignof(SidFilter::Block) == 0 && header->m_numFilterBlocks != 0 &&
+            header->m_filterOffset <= size && header->m_numFilterBlocks <= (size - header->m_filterOffset) / sizeof(SidFilter::Block) &&
+            (header->m_entriesOffset == 0 || (header->m_entriesOffset % 8 == 0 && header->m_entriesOffset <= size &&
+                num_entries <= (size - header->m_entriesOffset) / sizeof(SIDBaseEntry))) &&
+            (header->m_stringsOffset == 0 || (header->m_stringsOffset <= size && header->m_stringsSize <= size - header->m_stringsOffset));
+        if (!valid) {
+            munmap(view, size);
+            return false;
+        }
+
+        m_data = reinterpret_cast<std::byte*>(view);
+        m_size = size;
+        return true;
+    }
+
+    [[nodiscard]] std::byte* SidSharedSegment::create(const SidShmHeader& header) noexcept {
+        close();
+        m_name = segment_name(header.m_key);
+        const int fd = shm_open(m_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+        if (fd < 0) {
+            m_name.clear();
+            return nullptr;
+        }
+        if (ftruncate(fd, header.m_size) != 0) {
+            ::close(fd);
+            shm_unlink(m_name.c_str());
+            m_name.clear();
+            return nullptr;
+        }
+        void* view = mmap(nullptr, header.m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (view == MAP_FAILED) {
+            shm_unlink(m_name.c_str());
+            m_name.clear();
+            return nullptr;
+        }
+
+        m_data = reinterpret_cast<std::byte*>(view);
+        m_size = header.m_size;
+        SidShmHeader* out = reinterpret_cast<SidShmHeader*>(m_data);
+        *out = header;
+        out->m_magic = SID_SHM_MAGIC;
+        out->m_version = SID_SHM_VERSION;
+        out->m_ready = 0;
+        return m_data;
+    }
+
+    void SidSharedSegment::publish() noexcept {
+        SidShmHeader* header = reinterpret_cast<SidShmHeader*>(m_data);
+        __atomic_store_n(&header->m_ready, 1, __ATOMIC_RELEASE);
+        mprotect(m_data, m_size, PROT_READ);
+        m_name.clear();
+    }
+
+    void SidSharedSegment::abandon() noexcept {
+        if (!m_name.empty()) {
+            shm_unlink(m_name.c_str());
+            m_name.clear();
+        }
+        close();
+    }
+
+    void SidSharedSegment::close() noexcept {
+        if (m_data != nullptr) {
+            munmap(m_data, m_size);
+        }
+        m_data = nullptr;
+        m_size = 0;
+    }
+#endif
+}
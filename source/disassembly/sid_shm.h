@@ -0,0 +1,76 @@
+#pragma once
+
+#include "base.h"
+#include <string>
+
+namespace dconstruct {
+    /*
+        search index of a sidbase, published in a named shared memory segment by the first process that builds it.
+        later processes that load the same sidbase map it read-only instead of building their own copy.
+        the segment stays around after the publisher exits, until it's removed or the system restarts.
+
+        SidShmHeader
+        sid64 tree[m_numEntries + 1]                64 byte aligned eytzinger tree
+        u64 tree_offsets[m_numEntries + 1]
+        SidFilter::Block filter[m_numFilterBlocks]  32 byte aligned
+        SIDBaseEntry entries[m_numEntries]          only if m_entriesOffset != 0
+        char strings[m_stringsSize]                 only if m_stringsOffset != 0
+    */
+    struct SidShmHeader {
+        u32 m_magic;
+        u32 m_version;
+        u64 m_key;
+        u64 m_numEntries;
+        u64 m_size;
+        u64 m_treeOffset;
+        u64 m_treeOffsetsOffset;
+        u64 m_filterOffset;
+        u64 m_numFilterBlocks;
+        u64 m_entriesOffset;
+        u64 m_stringsOffset;
+        u64 m_stringsSize;
+        u32 m_ready;        // set by the publisher once everything else is written
+        u32 m_padding;
+    };
+
+    class SidSharedSegment {
+    public:
+        SidSharedSegment() = default;
+        SidSharedSegment(const SidSharedSegment&) = delete;
+        SidSharedSegment& operator=(const SidSharedSegment&) = delete;
+        ~SidSharedSegment();
+
+        // maps the segment with this key read-only, and waits for it to be published if another process is
+        // still writing it. the key has to cover everything that's in the segment.
+        [[nodiscard]] b8 attach(const u64 key, const u64 num_entries) noexcept;
+
+        // creates the segment with its header filled in. fails if it already exists.
+        [[nodiscard]] std::byte* create(const SidShmHeader& header) noexcept;
+        // makes a created segment visible to attach(), which also makes it read-only for this process
+        void publish() noexcept;
+        // removes a created segment that couldn't be filled in
+        void abandon() noexcept;
+
+        [[nodiscard]] b8 is_attached() const noexcept {
+            return m_data != nullptr;
+        }
+
+        [[nodiscard]] const SidShmHeader* header() const noexcept {
+            return reinterpret_cast<const SidShmHeader*>(m_data);
+        }
+
+        [[nodiscard]] const std::byte* data() const noexcept {
+            return m_data;
+        }
+
+        // whether this platform has named shared memory
+        [[nodiscard]] static b8 is_supported() noexcept;
+
+    private:
+        std::byte* m_data = nullptr;
+        u64 m_size = 0;
+        std::string m_name;
+
+        void close() noexcept;
+    };
+}
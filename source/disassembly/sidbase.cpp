@@ -1,42 +1,320 @@
 #include "sidbase.h"
+#include "hash.h"
+#include "radix_sort.h"
+#include "sidbase_builder.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
 #include <fstream>
 #include <filesystem>
 #include <iostream>
+#include <string>
 
-namespace dconstruct {
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define DCONSTRUCT_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
 
-    void SIDBase::load(const std::filesystem::path& path) noexcept {
+namespace dconstruct {
+    [[nodiscard]] static b8 is_sorted_scalar(const SIDBaseEntry* entries, const u64 first, const u64 num_entries) noexcept {
+        b8 unsorted = false;
+        for (u64 i = first + 1; i < num_entries; ++i) {
+            unsorted |= entries[i - 1].hash > entries[i].hash;
+        }
+        return !unsorted;
+    }
 
-        std::ifstream sidfile(path, std::ios::binary);
+#ifdef DCONSTRUCT_X86_DISPATCH
+    // compares 4 neighbouring pairs per iteration. the entries interleave hashes and offsets, so two unaligned
+    // loads of 2 entries each are unpacked into the hashes i..i+3 and, shifted by one entry, i+1..i+4.
+    // avx2 only has a signed 64 bit compare, so both sides get their sign bit flipped first.
+    __attribute__((target("avx2")))
+    [[nodiscard]] static b8 is_sorted_avx2(const SIDBaseEntry* entries, const u64 num_entries) noexcept {
+        const __m256i sign = _mm256_set1_epi64x(static_cast<i64>(0x8000000000000000ULL));
+        __m256i unsorted = _mm256_setzero_si256();
+        u64 i = 0;
+        for (; i + 5 <= num_entries; i += 4) {
+            const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(entries + i));
+            const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(entries + i + 2));
+            const __m256i next_lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(entries + i + 1));
+            const __m256i next_hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(entries + i + 3));
+            const __m256i current = _mm256_xor_si256(_mm256_unpacklo_epi64(lo, hi), sign);
+            const __m256i next = _mm256_xor_si256(_mm256_unpacklo_epi64(next_lo, next_hi), sign);
+            unsorted = _mm256_or_si256(unsorted, _mm256_cmpgt_epi64(current, next));
+        }
+        return _mm256_testz_si256(unsorted, unsorted) && is_sorted_scalar(entries, i, num_entries);
+    }
+#endif
 
-        if (!sidfile.is_open()) {
-            std::cout << "couldn't open sidbase at path \'" << path << "'\n";
-            exit(-1);
+    [[nodiscard]] static b8 is_sorted(const SIDBaseEntry* entries, const u64 num_entries) noexcept {
+#ifdef DCONSTRUCT_X86_DISPATCH
+        static const b8 has_avx2 = (__builtin_cpu_init(), __builtin_cpu_supports("avx2"));
+        if (has_avx2) {
+            return is_sorted_avx2(entries, num_entries);
         }
+#endif
+        return is_sorted_scalar(entries, 0, num_entries);
+    }
 
-        std::size_t fsize = std::filesystem::file_size(path);
-        std::byte* temp_buffer = new std::byte[fsize];
+    void SIDBaseLayer::load(const std::filesystem::path& path, const b8 use_perfect_hash) noexcept {
+        u64 fsize = 0;
+        if (m_mapping.open(path, MapAccess::READ_ONLY)) {
+            m_sidbytes = m_mapping.data();
+            fsize = m_mapping.size();
+        } else {
+            std::ifstream sidfile(path, std::ios::binary);
 
-        sidfile.read(reinterpret_cast<char*>(&m_numEntries), 8);
-        sidfile.seekg(0);
+            if (!sidfile.is_open()) {
+                std::cout << "couldn't open sidbase at path \'" << path << "'\n";
+                exit(-1);
+            }
 
-        sidfile.read(reinterpret_cast<char*>(temp_buffer), fsize);
+            fsize = std::filesystem::file_size(path);
+            m_ownedBytes = std::make_unique_for_overwrite<std::byte[]>(fsize);
+            sidfile.read(reinterpret_cast<char*>(m_ownedBytes.get()), fsize);
+            m_sidbytes = m_ownedBytes.get();
+        }
+
+        m_fileSize = fsize;
+        if (m_pool.open(m_sidbytes, fsize)) {
+            m_entries = m_pool.entries().data();
+            m_numEntries = m_pool.entries().size();
+        } else if (is_sid_pool(m_sidbytes, fsize)) {
+            std::cout << "compressed sidbase at path \'" << path << "' is damaged or was written by a different version\n";
+            exit(-1);
+        } else {
+            if (fsize >= 8) {
+                std::memcpy(&m_numEntries, m_sidbytes, 8);
+            }
+            if (fsize < 8 || m_numEntries == 0 || m_numEntries > (fsize - 8) / sizeof(SIDBaseEntry)) {
+                if (!m_mapping.is_open()) {
+                    std::cout << "sidbase at path \'" << path << "' has an invalid number of entries\n";
+                    exit(-1);
+                }
+                load_string_list(m_mapping);
+                if (m_numEntries == 0) {
+                    std::cout << "sidbase at path \'" << path << "' doesn't contain any sids\n";
+                    exit(-1);
+                }
+                m_mapping.close();
+                m_fingerprint = compute_fingerprint();
+                m_lowestSid = m_entries[0].hash;
+                m_highestSid = m_entries[m_numEntries - 1].hash;
+                return;
+            }
+            m_entries = reinterpret_cast<const SIDBaseEntry*>(m_sidbytes + 8);
+        }
+        m_fingerprint = compute_fingerprint();
+
+        // sidecars are only ever built for sorted sidbases, so the check can be skipped when there is one
+        if (use_perfect_hash && m_perfectHash.open(sid_mph_path(path), m_fingerprint)) {
+            m_filter.adopt(m_perfectHash.filter_blocks());
+        } else if (!is_sorted(m_entries, m_numEntries)) {
+            std::cout << "warning: sidbase at path \'" << path << "' isn't sorted. it's sorted in memory for now, use 'dconstruct sidbase build' to fix the file.\n";
+            m_sortedEntries.assign(m_entries, m_entries + m_numEntries);
+            m_sortedOnDisk = false;
+            parallel_radix_sort(m_sortedEntries, [](const SIDBaseEntry& entry) { return entry.hash; });
+            m_entries = m_sortedEntries.data();
+        }
 
-        m_entries = reinterpret_cast<SIDBaseEntry*>(temp_buffer + 8);
-        m_sidbytes = std::unique_ptr<std::byte[]>(temp_buffer);
         m_lowestSid = m_entries[0].hash;
         m_highestSid = m_entries[m_numEntries - 1].hash;
     }
 
-    [[nodiscard]] const char* SIDBase::search(const sid64 hash) const noexcept {
+    void SIDBaseLayer::load_string_list(const MappedFile& file) {
+        std::vector<char> pool;
+        std::vector<SIDBaseEntry> records;
+        read_string_list(file, pool, records);
+
+        // stable, so the first of several strings with the same hash is kept
+        parallel_radix_sort(records, [](const SIDBaseEntry& entry) { return entry.hash; });
+        m_sortedOnDisk = false;
+        m_sortedEntries.clear();
+        for (const SIDBaseEntry& record : records) {
+            if (m_sortedEntries.empty() || m_sortedEntries.back().hash != record.hash) {
+                m_sortedEntries.push_back(record);
+            }
+        }
+
+        m_fileSize = pool.size();
+        m_ownedBytes = std::make_unique_for_overwrite<std::byte[]>(m_fileSize);
+        std::memcpy(m_ownedBytes.get(), pool.data(), m_fileSize);
+        m_sidbytes = m_ownedBytes.get();
+        m_entries = m_sortedEntries.data();
+        m_numEntries = m_sortedEntries.size();
+    }
+
+    [[nodiscard]] const char* SIDBaseLayer::search(const sid64 hash) const noexcept {
+        u64 offset = 0;
+        return find(hash, offset) ? string_at(offset) : nullptr;
+    }
+
+    [[nodiscard]] b8 SIDBaseLayer::find(const sid64 hash, u64& offset) const noexcept {
+        if (m_filter.is_built() && !m_filter.may_contain(hash)) {
+            return false;
+        }
+        if (m_perfectHash.is_open()) {
+            const SIDBaseEntry* entry = m_perfectHash.find(hash);
+            if (entry == nullptr) {
+                return false;
+            }
+            offset = entry->offset;
+            return true;
+        }
+        return m_eytzinger != nullptr ? find_eytzinger(hash, offset) : find_sorted(hash, offset);
+    }
+
+    void SIDBaseLayer::build_search_index(const b8 use_shared_memory) {
+        if (m_perfectHash.is_open()) {
+            return;
+        }
+        if (use_shared_memory && attach_shared_index()) {
+            return;
+        }
+        m_filter.build(entries());
+        constexpr u64 keys_per_line = 64 / sizeof(sid64);
+
+        m_eytzingerStorage.assign(m_numEntries + 1 + keys_per_line, 0);
+        const u64 misalignment = reinterpret_cast<p64>(m_eytzingerStorage.data()) % 64 / sizeof(sid64);
+        sid64* tree = m_eytzingerStorage.data() + (misalignment == 0 ? 0 : keys_per_line - misalignment);
+        m_eytzingerOffsetStorage.assign(m_numEntries + 1, 0);
+
+        // an in-order walk of the implicit tree visits the nodes in sorted order
+        u64 next = 0;
+        u64 node = 1;
+        std::vector<u64> stack;
+        while (node <= m_numEntries || !stack.empty()) {
+            while (node <= m_numEntries) {
+                stack.push_back(node);
+                node *= 2;
+            }
+            node = stack.back();
+            stack.pop_back();
+            tree[node] = m_entries[next].hash;
+            m_eytzingerOffsetStorage[node] = m_entries[next].offset;
+            ++next;
+            node = node * 2 + 1;
+        }
+        m_eytzinger = tree;
+        m_eytzingerOffsets = m_eytzingerOffsetStorage.data();
+
+        if (use_shared_memory) {
+            publish_shared_index();
+        }
+    }
+
+    [[nodiscard]] b8 SIDBaseLayer::attach_shared_index() noexcept {
+        if (!m_shared.attach(shared_index_key(), m_numEntries)) {
+            return false;
+        }
+        use_shared_index();
+        return true;
+    }
+
+    void SIDBaseLayer::publish_shared_index() noexcept {
+        const auto align_up = [](const u64 value, const u64 alignment) { return (value + alignment - 1) / alignment * alignment; };
+        const std::span<const SidFilter::Block> filter = m_filter.blocks();
+        // entries and strings that only live in this process are shared too. compressed strings are only ever mapped.
+        const b8 share_entries = !m_sortedEntries.empty();
+        const b8 share_strings = owns_strings();
+
+        SidShmHeader header{};
+        header.m_key = shared_index_key();
+        header.m_numEntries = m_numEntries;
+        header.m_treeOffset = align_up(sizeof(SidShmHeader), 64);
+        header.m_treeOffsetsOffset = header.m_treeOffset + (m_numEntries + 1) * sizeof(sid64);
+        header.m_filterOffset = align_up(header.m_treeOffsetsOffset + (m_numEntries + 1) * sizeof(u64), alignof(SidFilter::Block));
+        header.m_numFilterBlocks = filter.size();
+        u64 end = header.m_filterOffset + filter.size_bytes();
+        if (share_entries) {
+            header.m_entriesOffset = end;
+            end += m_numEntries * sizeof(SIDBaseEntry);
+        }
+        if (share_strings) {
+            header.m_stringsOffset = end;
+            header.m_stringsSize = m_fileSize;
+            end += m_fileSize;
+        }
+        header.m_size = end;
+
+        // fails if another process got there first, in which case this one just keeps its own index
+        std::byte* out = m_shared.create(header);
+        if (out == nullptr) {
+            return;
+        }
+        std::memcpy(out + header.m_treeOffset, m_eytzinger, (m_numEntries + 1) * sizeof(sid64));
+        std::memcpy(out + header.m_treeOffsetsOffset, m_eytzingerOffsets, (m_numEntries + 1) * sizeof(u64));
+        std::memcpy(out + header.m_filterOffset, filter.data(), filter.size_bytes());
+        if (share_entries) {
+            std::memcpy(out + header.m_entriesOffset, m_entries, m_numEntries * sizeof(SIDBaseEntry));
+        }
+        if (share_strings) {
+            std::memcpy(out + header.m_stringsOffset, m_sidbytes, m_fileSize);
+        }
+        m_shared.publish();
+        use_shared_index();
+    }
+
+    [[nodiscard]] b8 SIDBaseLayer::owns_strings() const noexcept {
+        return m_ownedBytes != nullptr && !m_pool.is_open();
+    }
+
+    [[nodiscard]] u64 SIDBaseLayer::shared_index_key() const noexcept {
+        // the whole hash table, unlike the fingerprint, since a segment is found by every sidbase on the system
+        u64 key = identity();
+        if (owns_strings()) {
+            key = hash_bytes(m_sidbytes, m_fileSize, key);
+        }
+        return key;
+    }
+
+    void SIDBaseLayer::use_shared_index() noexcept {
+        const SidShmHeader* header = m_shared.header();
+        const std::byte* data = m_shared.data();
+        m_eytzinger = reinterpret_cast<const sid64*>(data + header->m_treeOffset);
+        m_eytzingerOffsets = reinterpret_cast<const u64*>(data + header->m_treeOffsetsOffset);
+        m_filter.adopt({ reinterpret_cast<const SidFilter::Block*>(data + header->m_filterOffset), header->m_numFilterBlocks });
+        std::vector<sid64>().swap(m_eytzingerStorage);
+        std::vector<u64>().swap(m_eytzingerOffsetStorage);
+
+        if (header->m_entriesOffset != 0 && !m_sortedEntries.empty()) {
+            m_entries = reinterpret_cast<const SIDBaseEntry*>(data + header->m_entriesOffset);
+            std::vector<SIDBaseEntry>().swap(m_sortedEntries);
+        }
+        if (header->m_stringsOffset != 0 && owns_strings() && header->m_stringsSize == m_fileSize) {
+            m_sidbytes = data + header->m_stringsOffset;
+            m_ownedBytes.reset();
+        }
+    }
+
+    [[nodiscard]] b8 SIDBaseLayer::find_eytzinger(const sid64 hash, u64& offset) const noexcept {
+        u64 node = 1;
+        while (node <= m_numEntries) {
+#if defined(__GNUC__) || defined(__clang__)
+            __builtin_prefetch(m_eytzinger + node * 8);
+#endif
+            node = node * 2 + (m_eytzinger[node] < hash);
+        }
+        // undo the right turns after the last left turn, which leaves the first hash >= the one we're looking for
+        node >>= std::countr_one(node) + 1;
+        if (node == 0 || m_eytzinger[node] != hash) {
+            return false;
+        }
+        offset = m_eytzingerOffsets[node];
+        return true;
+    }
+
+    [[nodiscard]] b8 SIDBaseLayer::find_sorted(const sid64 hash, u64& offset) const noexcept {
         u64 low = 0;
         u64 high = m_numEntries - 1;
         u64 mid = 0;
         while (low <= high) {
             mid = low + (high - low) / 2;
             const SIDBaseEntry* current = m_entries + mid;
-            if (current->hash == hash) [[unlikely]]
-                return reinterpret_cast<const char*>(m_sidbytes.get() + current->offset);
+            if (current->hash == hash) [[unlikely]] {
+                offset = current->offset;
+                return true;
+            }
             if (current->hash < hash) {
                 low = mid + 1;
             }
@@ -45,10 +323,196 @@ namespace dconstruct {
                 high = mid - 1;
             }
         }
+        return false;
+    }
+
+    [[nodiscard]] std::span<const SIDBaseEntry> SIDBaseLayer::string_index() const {
+        std::call_once(m_stringIndexBuilt, [this]() {
+            if (m_pool.is_open()) {
+                // the pool already holds the strings in order
+                m_stringIndex.assign(m_entries, m_entries + m_numEntries);
+                parallel_radix_sort(m_stringIndex, [](const SIDBaseEntry& entry) { return entry.offset; });
+                return;
+            }
+            m_stringIndex.assign(m_entries, m_entries + m_numEntries);
+            sort_by_string(m_stringIndex, reinterpret_cast<const char*>(m_sidbytes));
+        });
+        return m_stringIndex;
+    }
+
+    [[nodiscard]] const SIDBaseEntry* SIDBaseLayer::find_string(const std::string_view str) const {
+        const std::span<const SIDBaseEntry> index = string_index();
+        const auto entry = std::lower_bound(index.begin(), index.end(), str, [this](const SIDBaseEntry& entry, const std::string_view value) {
+            return std::string_view(string_at(entry.offset)) < value;
+        });
+        if (entry == index.end() || std::string_view(string_at(entry->offset)) != str) {
+            return nullptr;
+        }
+        return &*entry;
+    }
+
+    [[nodiscard]] std::span<const SIDBaseEntry> SIDBaseLayer::with_prefix(const std::string_view prefix) const {
+        const std::span<const SIDBaseEntry> index = string_index();
+        // strings with the same prefix are next to each other, starting at the first string that isn't less than it
+        const auto first = std::lower_bound(index.begin(), index.end(), prefix, [this](const SIDBaseEntry& entry, const std::string_view value) {
+            return std::string_view(string_at(entry.offset)) < value;
+        });
+        const auto last = std::partition_point(first, index.end(), [this, prefix](const SIDBaseEntry& entry) {
+            return std::string_view(string_at(entry.offset)).starts_with(prefix);
+        });
+        return { first, last };
+    }
+
+    [[nodiscard]] b8 SIDBaseLayer::sid_exists(const sid64 hash) const noexcept {
+        u64 offset = 0;
+        return find(hash, offset);
+    }
+
+    [[nodiscard]] u64 SIDBaseLayer::identity() const noexcept {
+        return hash_bytes(m_entries, m_numEntries * sizeof(SIDBaseEntry), m_numEntries);
+    }
+
+    [[nodiscard]] u64 SIDBaseLayer::offset_of(const char* str) const noexcept {
+        if (m_pool.is_open()) {
+            return m_pool.offset_of(str);
+        }
+        return reinterpret_cast<const std::byte*>(str) - m_sidbytes;
+    }
+
+    [[nodiscard]] const char* SIDBaseLayer::string_at(const u64 offset) const noexcept {
+        if (m_pool.is_open()) {
+            return m_pool.string_at(offset);
+        }
+        return reinterpret_cast<const char*>(m_sidbytes + offset);
+    }
+
+    [[nodiscard]] b8 SIDBaseLayer::is_valid_offset(const u64 offset) const noexcept {
+        if (m_pool.is_open()) {
+            // string_at() already turns offsets inside of the range that don't hit a string into ""
+            return offset < m_pool.offset_range();
+        }
+        return offset < m_fileSize && std::memchr(m_sidbytes + offset, 0, m_fileSize - offset) != nullptr;
+    }
+
+    [[nodiscard]] b8 SIDBaseLayer::owns(const char* str) const noexcept {
+        if (m_pool.is_open()) {
+            return m_pool.owns(str);
+        }
+        return reinterpret_cast<const std::byte*>(str) >= m_sidbytes && reinterpret_cast<const std::byte*>(str) < m_sidbytes + m_fileSize;
+    }
+
+    [[nodiscard]] u64 SIDBaseLayer::compute_fingerprint() const noexcept {
+        constexpr u64 num_samples = 64;
+        u64 hash = hash_bytes(&m_fileSize, sizeof(m_fileSize), m_numEntries);
+        for (u64 i = 0; i < num_samples; ++i) {
+            const SIDBaseEntry& entry = m_entries[(m_numEntries - 1) * i / (num_samples - 1)];
+            hash = hash_bytes(&entry, sizeof(entry), hash);
+        }
+        return hash;
+    }
+
+    void SIDBase::load(const std::filesystem::path& path, const b8 use_perfect_hash) noexcept {
+        m_layers.clear();
+        m_layerStarts.clear();
+        add_layer(path, use_perfect_hash);
+    }
+
+    void SIDBase::add_layer(const std::filesystem::path& path, const b8 use_perfect_hash) noexcept {
+        std::unique_ptr<SIDBaseLayer> layer = std::make_unique<SIDBaseLayer>();
+        layer->load(path, use_perfect_hash);
+        if (m_layers.empty()) {
+            m_layerStarts.push_back(0);
+            m_lowestSid = layer->m_lowestSid;
+            m_highestSid = layer->m_highestSid;
+        } else {
+            m_layerStarts.push_back(m_layerStarts.back() + m_layers.back()->offset_range());
+            m_lowestSid = std::min(m_lowestSid, layer->m_lowestSid);
+            m_highestSid = std::max(m_highestSid, layer->m_highestSid);
+        }
+        m_layers.push_back(std::move(layer));
+    }
+
+    [[nodiscard]] const char* SIDBase::search(const sid64 hash) const noexcept {
+        for (auto layer = m_layers.rbegin(); layer != m_layers.rend(); ++layer) {
+            if (const char* str = (*layer)->search(hash)) {
+                return str;
+            }
+        }
         return nullptr;
     }
 
+    void SIDBase::build_search_index(const b8 use_shared_memory) {
+        for (const std::unique_ptr<SIDBaseLayer>& layer : m_layers) {
+            layer->build_search_index(use_shared_memory);
+        }
+    }
+
     [[nodiscard]] b8 SIDBase::sid_exists(const sid64 hash) const noexcept {
         return search(hash) != nullptr;
     }
-}
\ No newline at end of file
+
+    [[nodiscard]] b8 SIDBase::find_hash(const std::string_view str, sid64& hash) const {
+        // nearly every string is stored under the hash the game would give it, which doesn't need the reverse index
+        const sid64 game_hash = SID(std::string(str).c_str());
+        const char* resolved = search(game_hash);
+        if (resolved != nullptr && std::string_view(resolved) == str) {
+            hash = game_hash;
+            return true;
+        }
+        for (auto layer = m_layers.rbegin(); layer != m_layers.rend(); ++layer) {
+            const SIDBaseEntry* entry = (*layer)->find_string(str);
+            if (entry != nullptr && layer_of(entry->hash) == layer->get()) {
+                hash = entry->hash;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    [[nodiscard]] const SIDBaseLayer* SIDBase::layer_of(const sid64 hash) const noexcept {
+        for (auto layer = m_layers.rbegin(); layer != m_layers.rend(); ++layer) {
+            if ((*layer)->sid_exists(hash)) {
+                return layer->get();
+            }
+        }
+        return nullptr;
+    }
+
+    [[nodiscard]] u64 SIDBase::identity() const noexcept {
+        u64 hash = m_layers.front()->identity();
+        for (u64 i = 1; i < m_layers.size(); ++i) {
+            const u64 layer_identity = m_layers[i]->identity();
+            hash = hash_bytes(&layer_identity, sizeof(layer_identity), hash);
+        }
+        return hash;
+    }
+
+    [[nodiscard]] u64 SIDBase::offset_of(const char* str) const noexcept {
+        for (u64 i = 0; i < m_layers.size(); ++i) {
+            if (m_layers[i]->owns(str)) {
+                const u64 offset = m_layers[i]->offset_of(str);
+                return offset != SID_NO_OFFSET ? m_layerStarts[i] + offset : SID_NO_OFFSET;
+            }
+        }
+        return SID_NO_OFFSET;
+    }
+
+    [[nodiscard]] const char* SIDBase::string_at(const u64 offset) const noexcept {
+        u64 i = m_layers.size() - 1;
+        while (i > 0 && m_layerStarts[i] > offset) {
+            --i;
+        }
+        return m_layers[i]->string_at(offset - m_layerStarts[i]);
+    }
+
+    [[nodiscard]] b8 SIDBase::is_valid_offset(const u64 offset) const noexcept {
+        if (m_layers.empty()) {
+            return false;
+        }
+        u64 i = m_layers.size() - 1;
+        while (i > 0 && m_layerStarts[i] > offset) {
+            --i;
+        }
+        return m_layers[i]->is_valid_offset(offset - m_layerStarts[i]);
+    }
+}
@@ -1,7 +1,16 @@
 #pragma once
 #include "base.h"
+#include "mapped_file.h"
+#include "sid_mph.h"
+#include "sid_filter.h"
+#include "sid_pool.h"
+#include "sid_shm.h"
 #include <memory>
+#include <mutex>
 #include <filesystem>
+#include <span>
+#include <string_view>
+#include <vector>
 
 namespace dconstruct {
     struct SIDBaseEntry {
@@ -9,20 +18,163 @@ namespace dconstruct {
         u64 offset;
     };
 
-    class SIDBase {
+    // a single sidbase file with its own search index
+    class SIDBaseLayer {
 
     public:
-        void load(const std::filesystem::path& path) noexcept;
+        // maps the perfect hash sidecar next to the sidbase too, if there is one that belongs to it.
+        // a file that isn't a sidbase is read as a list of strings, one per line, which is hashed and sorted in memory.
+        void load(const std::filesystem::path& path, const b8 use_perfect_hash = true) noexcept;
+        // strings of a compressed sidbase live in the calling thread's block cache, see SidStringPool::string_at()
         [[nodiscard]] const char* search(const sid64 hash) const noexcept;
+        // lays the hashes out in eytzinger order, so a search only misses the cache a couple of times instead of
+        // on nearly every probe, and builds the prefilter that turns away most values that aren't sids.
+        // reads the whole hash table, so it's only worth it for runs with lots of lookups.
+        // with use_shared_memory, the index is taken from another process that already built it for the same
+        // sidbase, or published for the next ones if there is none yet. see SidSharedSegment.
+        void build_search_index(const b8 use_shared_memory = false);
+        [[nodiscard]] b8 has_shared_index() const noexcept {
+            return m_shared.is_attached();
+        }
+        [[nodiscard]] b8 has_search_index() const noexcept {
+            return m_eytzinger != nullptr || m_perfectHash.is_open();
+        }
+        [[nodiscard]] b8 has_perfect_hash() const noexcept {
+            return m_perfectHash.is_open();
+        }
         [[nodiscard]] b8 sid_exists(const sid64 hash) const noexcept;
+        // hash over the whole hash table. two sidbases with the same identity resolve every sid the same way.
+        [[nodiscard]] u64 identity() const noexcept;
+        // strings returned by search() can be stored as offsets into the sidbase, so they stay valid across runs.
+        // SID_NO_OFFSET if the string isn't one of the sidbase's (anymore, see SidStringPool::offset_of()).
+        [[nodiscard]] u64 offset_of(const char* str) const noexcept;
+        [[nodiscard]] const char* string_at(const u64 offset) const noexcept;
+        // whether string_at(offset) stays inside of the sidbase, for offsets that were stored somewhere else
+        [[nodiscard]] b8 is_valid_offset(const u64 offset) const noexcept;
+        // the entry whose string is exactly str, or nullptr
+        [[nodiscard]] const SIDBaseEntry* find_string(const std::string_view str) const;
+        // all entries whose string starts with prefix, sorted by string
+        [[nodiscard]] std::span<const SIDBaseEntry> with_prefix(const std::string_view prefix) const;
+        [[nodiscard]] b8 owns(const char* str) const noexcept;
+        // offsets of strings are in [0, offset_range())
+        [[nodiscard]] u64 offset_range() const noexcept {
+            return m_pool.is_open() ? m_pool.offset_range() : m_fileSize;
+        }
+        [[nodiscard]] b8 is_compressed() const noexcept {
+            return m_pool.is_open();
+        }
+        // cheap check that a sidecar was built for this sidbase. only samples the hash table, unlike identity().
+        // taken over the file as it is on disk, before an unsorted sidbase gets sorted in memory
+        [[nodiscard]] u64 fingerprint() const noexcept {
+            return m_fingerprint;
+        }
+        [[nodiscard]] b8 is_sorted_on_disk() const noexcept {
+            return m_sortedOnDisk;
+        }
+        [[nodiscard]] std::span<const SIDBaseEntry> entries() const noexcept {
+            return { m_entries, m_numEntries };
+        }
         sid64 m_lowestSid;
         sid64 m_highestSid;
 
 
     private:
         u64 m_numEntries = 0;
-        std::unique_ptr<std::byte[]> m_sidbytes;
-        SIDBaseEntry* m_entries = nullptr;
+        // the sidbase is mapped read-only, so only the pages a lookup actually touches are ever read.
+        // m_ownedBytes is only used if the file can't be mapped.
+        // for a compressed sidbase, m_pool decodes the strings and the offsets of the entries point into it.
+        MappedFile m_mapping;
+        std::unique_ptr<std::byte[]> m_ownedBytes;
+        const std::byte* m_sidbytes = nullptr;
+        const SIDBaseEntry* m_entries = nullptr;
+        SidStringPool m_pool;
+
+        // 1-based eytzinger tree over the hashes, 64 byte aligned so the 8 descendants three levels down share
+        // a cache line. m_eytzingerOffsets holds the string offset of the hash at the same position.
+        std::vector<sid64> m_eytzingerStorage;
+        const sid64* m_eytzinger = nullptr;
+        std::vector<u64> m_eytzingerOffsetStorage;
+        const u64* m_eytzingerOffsets = nullptr;
+
+        // only used if the entries in the file aren't sorted
+        std::vector<SIDBaseEntry> m_sortedEntries;
+        b8 m_sortedOnDisk = true;
+        u64 m_fingerprint = 0;
+
+        SidPerfectHash m_perfectHash;
+        SidFilter m_filter;
+        u64 m_fileSize = 0;
+        // the index, and whatever else this layer would otherwise keep in memory, shared with other processes
+        SidSharedSegment m_shared;
+
+        // the entries sorted by their strings, only built the first time a string is looked up
+        mutable std::once_flag m_stringIndexBuilt;
+        mutable std::vector<SIDBaseEntry> m_stringIndex;
+
+        void load_string_list(const MappedFile& file);
+        [[nodiscard]] b8 attach_shared_index() noexcept;
+        void publish_shared_index() noexcept;
+        void use_shared_index() noexcept;
+        [[nodiscard]] b8 owns_strings() const noexcept;
+        [[nodiscard]] u64 shared_index_key() const noexcept;
+        [[nodiscard]] std::span<const SIDBaseEntry> string_index() const;
+        [[nodiscard]] u64 compute_fingerprint() const noexcept;
+        [[nodiscard]] b8 find(const sid64 hash, u64& offset) const noexcept;
+        [[nodiscard]] b8 find_sorted(const sid64 hash, u64& offset) const noexcept;
+        [[nodiscard]] b8 find_eytzinger(const sid64 hash, u64& offset) const noexcept;
+    };
+
+    /*
+        one large base sidbase with any number of small overlays on top of it, like lists of newly found names.
+        every layer keeps its own index, so adding names to an overlay never means rebuilding the base.
+        a lookup asks the layers from the last one added down to the base, so an overlay wins over the layers below it.
+        offsets of strings are taken over all layers one after another, in the order they were added.
+    */
+    class SIDBase {
+
+    public:
+        // replaces all layers with the sidbase at path
+        void load(const std::filesystem::path& path, const b8 use_perfect_hash = true) noexcept;
+        void add_layer(const std::filesystem::path& path, const b8 use_perfect_hash = true) noexcept;
+        // the string only outlives a few more lookups on the same thread if it comes from a compressed layer,
+        // so copy it if it has to be kept around for longer
+        [[nodiscard]] const char* search(const sid64 hash) const noexcept;
+        void build_search_index(const b8 use_shared_memory = false);
+        [[nodiscard]] b8 sid_exists(const sid64 hash) const noexcept;
+        // the reverse of search(). only finds str if its hash actually resolves to it, so not if an overlay
+        // gave that hash a different string.
+        [[nodiscard]] b8 find_hash(const std::string_view str, sid64& hash) const;
+        // calls func(hash, str) for every string that starts with prefix and that its hash resolves to.
+        // sorted within every layer, overlays first.
+        template<typename Func>
+        void for_each_with_prefix(const std::string_view prefix, Func&& func) const {
+            for (auto layer = m_layers.rbegin(); layer != m_layers.rend(); ++layer) {
+                for (const SIDBaseEntry& entry : (*layer)->with_prefix(prefix)) {
+                    if (layer_of(entry.hash) == layer->get()) {
+                        func(entry.hash, (*layer)->string_at(entry.offset));
+                    }
+                }
+            }
+        }
+        // hash over the hash tables of all layers. equal to the identity of the base if there are no overlays.
+        [[nodiscard]] u64 identity() const noexcept;
+        [[nodiscard]] u64 offset_of(const char* str) const noexcept;
+        [[nodiscard]] const char* string_at(const u64 offset) const noexcept;
+        [[nodiscard]] b8 is_valid_offset(const u64 offset) const noexcept;
+        [[nodiscard]] std::span<const std::unique_ptr<SIDBaseLayer>> layers() const noexcept {
+            return m_layers;
+        }
+        sid64 m_lowestSid = 0;
+        sid64 m_highestSid = 0;
+
+
+    private:
+        std::vector<std::unique_ptr<SIDBaseLayer>> m_layers;
+        // where the offsets of every layer start
+        std::vector<u64> m_layerStarts;
+
+        // the layer that search() finds hash in
+        [[nodiscard]] const SIDBaseLayer* layer_of(const sid64 hash) const noexcept;
     };
 }
 
@@ -0,0 +1,235 @@
+#include "sidbase_builder.h"
+#include "sidbase.h"
+#include "mapped_file.h"
+#include "radix_sort.h"
+#include "sid_pool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+namespace dconstruct {
+    static constexpr u64 MAX_REPORTED_COLLISIONS = 16;
+
+    // appends the entries of file if it's a well formed sidbase. sorting doesn't matter.
+    [[nodiscard]] static b8 read_binary_sidbase(const MappedFile& file, std::vector<char>& pool, std::vector<SIDBaseEntry>& records) {
+        const u64 size = file.size();
+        if (size < 8) {
+            return false;
+        }
+        u64 num_entries = 0;
+        std::memcpy(&num_entries, file.data(), sizeof(num_entries));
+        if (num_entries == 0 || num_entries > (size - 8) / sizeof(SIDBaseEntry)) {
+            return false;
+        }
+
+        const char* bytes = reinterpret_cast<const char*>(file.data());
+        const SIDBaseEntry* entries = reinterpret_cast<const SIDBaseEntry*>(file.data() + 8);
+        const u64 strings_start = 8 + num_entries * sizeof(SIDBaseEntry);
+        for (u64 i = 0; i < num_entries; ++i) {
+            const u64 offset = entries[i].offset;
+            if (offset < strings_start || offset >= size || std::memchr(bytes + offset, '\0', size - offset) == nullptr) {
+                return false;
+            }
+        }
+
+        records.reserve(records.size() + num_entries);
+        for (u64 i = 0; i < num_entries; ++i) {
+            const char* str = bytes + entries[i].offset;
+            records.push_back(SIDBaseEntry{ entries[i].hash, pool.size() });
+            pool.insert(pool.end(), str, str + std::strlen(str) + 1);
+        }
+        return true;
+    }
+
+    // appends the entries of file if it's a compressed sidbase
+    [[nodiscard]] static b8 read_sid_pool(const MappedFile& file, std::vector<char>& pool, std::vector<SIDBaseEntry>& records) {
+        SidStringPool sid_pool;
+        if (!sid_pool.open(file.data(), file.size())) {
+            return false;
+        }
+        sid_pool.decode_all(pool, records);
+        return true;
+    }
+
+    void read_string_list(const MappedFile& file, std::vector<char>& pool, std::vector<SIDBaseEntry>& records) {
+        const char* pos = reinterpret_cast<const char*>(file.data());
+        const char* const end = pos + file.size();
+        while (pos < end) {
+            const char* line_end = reinterpret_cast<const char*>(std::memchr(pos, '\n', end - pos));
+            if (line_end == nullptr) {
+                line_end = end;
+            }
+            const char* str_end = line_end;
+            if (str_end > pos && str_end[-1] == '\r') {
+                --str_end;
+            }
+            if (str_end > pos) {
+                const u64 offset = pool.size();
+                pool.insert(pool.end(), pos, str_end);
+                pool.push_back('\0');
+                records.push_back(SIDBaseEntry{ ToStringId64(pool.data() + offset), offset });
+            }
+            pos = line_end + 1;
+        }
+    }
+
+    void sort_by_string(std::vector<SIDBaseEntry>& entries, const char* strings) {
+        // the first 8 bytes of every string as a big endian number order the same way the strings do, so a radix
+        // sort on them does most of the work, and only strings that start the same have to be compared
+        struct SortKey {
+            u64 m_prefix;
+            SIDBaseEntry m_entry;
+        };
+        std::vector<SortKey> keys(entries.size());
+        for (u64 i = 0; i < entries.size(); ++i) {
+            const char* str = strings + entries[i].offset;
+            u64 prefix = 0;
+            for (u32 j = 0; j < sizeof(prefix) && str[j] != '\0'; ++j) {
+                prefix |= static_cast<u64>(static_cast<u8>(str[j])) << (56 - j * 8);
+            }
+            keys[i] = SortKey{ prefix, entries[i] };
+        }
+        parallel_radix_sort(keys, [](const SortKey& key) { return key.m_prefix; });
+
+        for (u64 first = 0; first < keys.size();) {
+            u64 last = first + 1;
+            while (last < keys.size() && keys[last].m_prefix == keys[first].m_prefix) {
+                ++last;
+            }
+            if (last - first > 1) {
+                std::sort(keys.begin() + first, keys.begin() + last, [strings](const SortKey& lhs, const SortKey& rhs) {
+                    return std::string_view(strings + lhs.m_entry.offset) < std::string_view(strings + rhs.m_entry.offset);
+                });
+            }
+            first = last;
+        }
+        for (u64 i = 0; i < entries.size(); ++i) {
+            entries[i] = keys[i].m_entry;
+        }
+    }
+
+    [[nodiscard]] b8 build_sidbase(std::span<const std::filesystem::path> inputs, const std::filesystem::path& out, const b8 compress, SidbaseBuildStats& stats) {
+        std::vector<char> pool;
+        std::vector<SIDBaseEntry> records;
+
+        for (const std::filesystem::path& input : inputs) {
+            MappedFile file;
+            if (!file.open(input, MapAccess::READ_ONLY)) {
+                std::cout << "error: couldn't open " << input << '\n';
+                return false;
+            }
+            if (read_sid_pool(file, pool, records)) {
+                std::cout << "read " << input << " as a compressed sidbase\n";
+            } else if (read_binary_sidbase(file, pool, records)) {
+                std::cout << "read " << input << " as a sidbase\n";
+            } else {
+                read_string_list(file, pool, records);
+                std::cout << "read " << input << " as a list of strings\n";
+            }
+        }
+        stats.m_numInputs = records.size();
+        if (records.empty()) {
+            std::cout << "error: the inputs don't contain any strings\n";
+            return false;
+        }
+
+        // stable, so out of every group of equal hashes the one that was read first ends up in front
+        parallel_radix_sort(records, [](const SIDBaseEntry& record) { return record.hash; });
+
+        std::vector<SIDBaseEntry> kept;
+        kept.reserve(records.size());
+        for (const SIDBaseEntry& record : records) {
+            if (kept.empty() || kept.back().hash != record.hash) {
+                kept.push_back(record);
+                continue;
+            }
+            const char* first = pool.data() + kept.back().offset;
+            const char* other = pool.data() + record.offset;
+            if (std::strcmp(first, other) == 0) {
+                ++stats.m_numDuplicates;
+                continue;
+            }
+            if (++stats.m_numCollisions <= MAX_REPORTED_COLLISIONS) {
+                std::cout << "warning: " << int_to_string_id(record.hash) << " is the hash of both '" << first << "' and '" << other << "', keeping '" << first << "'\n";
+            }
+        }
+        if (stats.m_numCollisions > MAX_REPORTED_COLLISIONS) {
+            std::cout << "warning: " << stats.m_numCollisions - MAX_REPORTED_COLLISIONS << " more collisions\n";
+        }
+        stats.m_numEntries = kept.size();
+        return write_sidbase(out, kept, pool.data(), compress);
+    }
+
+    [[nodiscard]] b8 write_sidbase(const std::filesystem::path& out, std::span<const SIDBaseEntry> entries, const char* strings, const b8 compress) {
+        if (compress) {
+            return write_sid_pool(out, entries, strings);
+        }
+
+        std::vector<SIDBaseEntry> out_entries(entries.size());
+        std::vector<char> out_strings;
+        const u64 strings_start = 8 + entries.size() * sizeof(SIDBaseEntry);
+        for (u64 i = 0; i < entries.size(); ++i) {
+            const char* str = strings + entries[i].offset;
+            out_entries[i] = SIDBaseEntry{ entries[i].hash, strings_start + out_strings.size() };
+            out_strings.insert(out_strings.end(), str, str + std::strlen(str) + 1);
+        }
+
+        std::filesystem::path temp_path = out;
+        temp_path += ".tmp";
+        {
+            std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+            if (!file.is_open()) {
+                std::cout << "error: couldn't open " << temp_path << " for writing\n";
+                return false;
+            }
+            const u64 num_entries = out_entries.size();
+            file.write(reinterpret_cast<const char*>(&num_entries), sizeof(num_entries));
+            file.write(reinterpret_cast<const char*>(out_entries.data()), out_entries.size() * sizeof(SIDBaseEntry));
+            file.write(out_strings.data(), out_strings.size());
+            if (!file.good()) {
+                file.close();
+                std::error_code ec;
+                std::filesystem::remove(temp_path, ec);
+                std::cout << "error: couldn't write " << out << '\n';
+                return false;
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(temp_path, out, ec);
+        if (ec) {
+            std::filesystem::remove(temp_path, ec);
+            std::cout << "error: couldn't write " << out << '\n';
+            return false;
+        }
+        return true;
+    }
+
+    [[nodiscard]] b8 write_sidbase_subset(const SIDBase& base, std::span<const sid64> hashes, const std::filesystem::path& out, const b8 compress, u64& num_entries) {
+        std::vector<sid64> kept_hashes(hashes.begin(), hashes.end());
+        // is_sid() accepts everything between the lowest and the highest sid of the sidbase, so the subset keeps both
+        kept_hashes.push_back(base.m_lowestSid);
+        kept_hashes.push_back(base.m_highestSid);
+        std::sort(kept_hashes.begin(), kept_hashes.end());
+        kept_hashes.erase(std::unique(kept_hashes.begin(), kept_hashes.end()), kept_hashes.end());
+
+        std::vector<char> pool;
+        std::vector<SIDBaseEntry> entries;
+        entries.reserve(kept_hashes.size());
+        for (const sid64 hash : kept_hashes) {
+            // copied right away, a string from a compressed layer only stays valid for a few lookups
+            const char* str = base.search(hash);
+            if (str == nullptr) {
+                continue;
+            }
+            entries.push_back(SIDBaseEntry{ hash, pool.size() });
+            pool.insert(pool.end(), str, str + std::strlen(str) + 1);
+        }
+        num_entries = entries.size();
+        return write_sidbase(out, entries, pool.data(), compress);
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "base.h"
+#include <filesystem>
+#include <span>
+#include <vector>
+
+namespace dconstruct {
+    struct SIDBaseEntry;
+    class MappedFile;
+    class SIDBase;
+
+    struct SidbaseBuildStats {
+        u64 m_numInputs = 0;        // strings read from all inputs
+        u64 m_numEntries = 0;       // entries in the written sidbase
+        u64 m_numDuplicates = 0;    // the same string (with the same hash) seen more than once
+        u64 m_numCollisions = 0;    // different strings with the same hash. the first one read wins.
+    };
+
+    // appends every non-empty line of file to pool, and an entry with the line's hash (hashed the same way the game
+    // hashes its strings) and its offset in pool to records
+    void read_string_list(const MappedFile& file, std::vector<char>& pool, std::vector<SIDBaseEntry>& records);
+
+    // sorts entries by their strings, which start at strings + offset
+    void sort_by_string(std::vector<SIDBaseEntry>& entries, const char* strings);
+
+    /*
+        builds a sorted sidbase out of any number of inputs. an input is either an existing sidbase in any order
+        (compressed or not), whose hashes are kept as they are, or a text file with one string per line, which gets
+        hashed with ToStringId64. the output can be loaded straight away. with compress, its strings are front coded.
+    */
+    [[nodiscard]] b8 build_sidbase(std::span<const std::filesystem::path> inputs, const std::filesystem::path& out, const b8 compress, SidbaseBuildStats& stats);
+
+    // writes entries (sorted by hash, offsets into strings) as a sidbase, front coded with compress
+    [[nodiscard]] b8 write_sidbase(const std::filesystem::path& out, std::span<const SIDBaseEntry> entries, const char* strings, const b8 compress);
+
+    /*
+        writes a sidbase with only the given hashes that base can resolve, each with the string base resolves it to,
+        so it gives the same answers as base for everything that only looks up those hashes.
+        num_entries is set to the number of entries written.
+    */
+    [[nodiscard]] b8 write_sidbase_subset(const SIDBase& base, std::span<const sid64> hashes, const std::filesystem::path& out, const b8 compress, u64& num_entries);
+}
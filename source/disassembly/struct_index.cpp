@@ -0,0 +1,188 @@
+#include "struct_index.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace dconstruct {
+    [[nodiscard]] u32 StructIndex::add(const sid64 type_id, const u32 offset, const u32 parent) {
+        const auto [iter, inserted] = m_pending.emplace(offset, m_ownedStructs.size());
+        if (!inserted) {
+            return NO_PARENT;
+        }
+        m_ownedStructs.push_back(StructRecord{ type_id, offset, 0, 0, 0, parent });
+        return iter->second;
+    }
+
+    void StructIndex::add_function(const FunctionRecord& function) {
+        m_ownedFunctions.push_back(function);
+    }
+
+    void StructIndex::add_resolved_sid(const ResolvedSid& sid) {
+        if (!m_built) {
+            m_ownedSids.push_back(sid);
+            return;
+        }
+        // the table is searched once the index is built, so it has to stay sorted
+        detach();
+        const auto iter = std::lower_bound(m_ownedSids.begin(), m_ownedSids.end(), sid.m_sid, [](const ResolvedSid& resolved, const sid64 sid) {
+            return resolved.m_sid < sid;
+        });
+        if (iter == m_ownedSids.end() || iter->m_sid != sid.m_sid) {
+            m_ownedSids.insert(iter, sid);
+        }
+        update_views();
+    }
+
+    void StructIndex::set_members(const u32 index, const std::span<const StructMember> members, const u32 size) {
+        detach();
+        StructRecord& record = m_ownedStructs[index];
+        if (members.size() <= record.m_numMembers) {
+            std::copy(members.begin(), members.end(), m_ownedMembers.begin() + record.m_firstMember);
+        } else {
+            record.m_firstMember = m_ownedMembers.size();
+            m_ownedMembers.insert(m_ownedMembers.end(), members.begin(), members.end());
+        }
+        record.m_numMembers = members.size();
+        record.m_size = size;
+        update_views();
+    }
+
+    void StructIndex::finalize() {
+        std::vector<u32> order(m_ownedStructs.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [this](const u32 lhs, const u32 rhs) {
+            return m_ownedStructs[lhs].m_offset < m_ownedStructs[rhs].m_offset;
+        });
+
+        std::vector<u32> new_index(m_ownedStructs.size());
+        for (u32 i = 0; i < order.size(); ++i) {
+            new_index[order[i]] = i;
+        }
+
+        std::vector<StructRecord> sorted;
+        sorted.reserve(m_ownedStructs.size());
+        for (const u32 old_index : order) {
+            StructRecord record = m_ownedStructs[old_index];
+            if (record.m_parent != NO_PARENT) {
+                record.m_parent = new_index[record.m_parent];
+            }
+            sorted.push_back(record);
+        }
+
+        m_ownedStructs = std::move(sorted);
+        std::sort(m_ownedFunctions.begin(), m_ownedFunctions.end(), [](const FunctionRecord& lhs, const FunctionRecord& rhs) {
+            return lhs.m_offset < rhs.m_offset;
+        });
+        // lambdas can be reached from more than one track
+        m_ownedFunctions.erase(std::unique(m_ownedFunctions.begin(), m_ownedFunctions.end(), [](const FunctionRecord& lhs, const FunctionRecord& rhs) {
+            return lhs.m_offset == rhs.m_offset;
+        }), m_ownedFunctions.end());
+        std::sort(m_ownedSids.begin(), m_ownedSids.end(), [](const ResolvedSid& lhs, const ResolvedSid& rhs) {
+            return lhs.m_sid < rhs.m_sid;
+        });
+        m_ownedSids.erase(std::unique(m_ownedSids.begin(), m_ownedSids.end(), [](const ResolvedSid& lhs, const ResolvedSid& rhs) {
+            return lhs.m_sid == rhs.m_sid;
+        }), m_ownedSids.end());
+        m_pending.clear();
+        m_built = true;
+        update_views();
+    }
+
+    void StructIndex::clear() noexcept {
+        m_ownedStructs.clear();
+        m_ownedMembers.clear();
+        m_ownedFunctions.clear();
+        m_ownedSids.clear();
+        m_pending.clear();
+        m_usedSids.clear();
+        m_mapping.close();
+        m_built = false;
+        m_detached = false;
+        update_views();
+    }
+
+    void StructIndex::adopt(
+        MappedFile&& mapping,
+        const std::span<const StructRecord> structs,
+        const std::span<const StructMember> members,
+        const std::span<const FunctionRecord> functions,
+        const std::span<const ResolvedSid> sids
+    ) noexcept {
+        clear();
+        m_mapping = std::move(mapping);
+        m_structs = structs;
+        m_members = members;
+        m_functions = functions;
+        m_sids = sids;
+        m_built = true;
+    }
+
+    void StructIndex::detach() {
+        if (!is_mapped() || m_detached) {
+            return;
+        }
+        m_detached = true;
+        m_ownedStructs.assign(m_structs.begin(), m_structs.end());
+        m_ownedMembers.assign(m_members.begin(), m_members.end());
+        m_ownedFunctions.assign(m_functions.begin(), m_functions.end());
+        m_ownedSids.assign(m_sids.begin(), m_sids.end());
+    }
+
+    void StructIndex::update_views() noexcept {
+        m_structs = m_ownedStructs;
+        m_members = m_ownedMembers;
+        m_functions = m_ownedFunctions;
+        m_sids = m_ownedSids;
+    }
+
+    [[nodiscard]] const StructRecord* StructIndex::at(const u32 offset) const noexcept {
+        const auto iter = std::lower_bound(m_structs.begin(), m_structs.end(), offset, [](const StructRecord& record, const u32 offset) {
+            return record.m_offset < offset;
+        });
+        if (iter == m_structs.end() || iter->m_offset != offset) {
+            return nullptr;
+        }
+        return &*iter;
+    }
+
+    [[nodiscard]] const StructRecord* StructIndex::find(const u32 offset) const noexcept {
+        auto iter = std::upper_bound(m_structs.begin(), m_structs.end(), offset, [](const u32 offset, const StructRecord& record) {
+            return offset < record.m_offset;
+        });
+        if (iter == m_structs.begin()) {
+            return nullptr;
+        }
+        --iter;
+        if (offset >= iter->m_offset + iter->m_size) {
+            return nullptr;
+        }
+        return &*iter;
+    }
+
+    [[nodiscard]] const FunctionRecord* StructIndex::function_at(const u32 offset) const noexcept {
+        const auto iter = std::lower_bound(m_functions.begin(), m_functions.end(), offset, [](const FunctionRecord& record, const u32 offset) {
+            return record.m_offset < offset;
+        });
+        if (iter == m_functions.end() || iter->m_offset != offset) {
+            return nullptr;
+        }
+        return &*iter;
+    }
+
+    [[nodiscard]] const ResolvedSid* StructIndex::resolved_sid(const sid64 sid) const noexcept {
+        const auto iter = std::lower_bound(m_sids.begin(), m_sids.end(), sid, [](const ResolvedSid& resolved, const sid64 sid) {
+            return resolved.m_sid < sid;
+        });
+        if (iter == m_sids.end() || iter->m_sid != sid) {
+            return nullptr;
+        }
+        return &*iter;
+    }
+
+    [[nodiscard]] std::vector<sid64> StructIndex::used_sids() const {
+        std::vector<sid64> sids = m_usedSids;
+        std::sort(sids.begin(), sids.end());
+        sids.erase(std::unique(sids.begin(), sids.end()), sids.end());
+        return sids;
+    }
+}
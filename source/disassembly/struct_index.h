@@ -0,0 +1,154 @@
+#pragma once
+
+#include "base.h"
+#include "mapped_file.h"
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace dconstruct {
+    enum class MemberKind : u8 {
+        POINTER,    // relocated pointer to a struct, array or string
+        STRING,     // relocated slot that lies inside the string table itself
+        RAW_STRING, // non-relocated slot inside the string table (only found in arrays)
+        SID,
+        FLOAT,
+        INT,
+    };
+
+    [[nodiscard]] constexpr u8 member_size(const MemberKind kind) noexcept {
+        return kind == MemberKind::FLOAT || kind == MemberKind::INT ? 4 : 8;
+    }
+
+    struct StructMember {
+        u32 m_offset;       // file offset of the member
+        MemberKind m_kind;
+    };
+
+    struct StructRecord {
+        sid64 m_typeId;     // 0 for the anonymous structs inside of arrays
+        u32 m_offset;       // file offset of the first member, the type ID sits right in front of it
+        u32 m_size;
+        u32 m_firstMember;
+        u32 m_numMembers;   // 0 for structs that aren't laid out member by member (state scripts, lambdas, maps)
+        u32 m_parent;       // index of the struct this one was first reached from
+    };
+
+    struct FunctionRecord {
+        u32 m_offset;           // file offset of the ScriptLambda
+        u32 m_codeOffset;
+        u32 m_numInstructions;
+        u32 m_symbolTableOffset;
+        u32 m_numArgs;
+    };
+
+    struct ResolvedSid {
+        constexpr static u64 NOT_FOUND = 0xFFFFFFFFFFFFFFFF;
+
+        sid64 m_sid;
+        u64 m_sidbaseOffset;    // offset of the string in the sidbase, or NOT_FOUND
+    };
+
+    // every struct and lambda that's reachable from the entries of a file, sorted by offset, plus the sids the
+    // file ended up looking up. built once per file by Disassembler::build_struct_index, so that the member layout
+    // heuristics only run once per struct. the tables either live in vectors or are views into a mapped .dcidx file.
+    class StructIndex {
+    public:
+        static constexpr u32 NO_PARENT = 0xFFFFFFFF;
+
+        // adds a row while building. returns NO_PARENT if there already is a struct at offset.
+        [[nodiscard]] u32 add(const sid64 type_id, const u32 offset, const u32 parent);
+        void add_function(const FunctionRecord& function);
+        // keeps the result of a search that was done while building, so it doesn't have to be repeated
+        void add_resolved_sid(const ResolvedSid& sid);
+        void set_members(const u32 index, const std::span<const StructMember> members, const u32 size);
+        // sorts the rows by offset. indices returned by add() are invalid afterwards.
+        void finalize();
+        void clear() noexcept;
+
+        // uses tables that were read from a sidecar. mapping keeps them alive.
+        void adopt(
+            MappedFile&& mapping,
+            const std::span<const StructRecord> structs,
+            const std::span<const StructMember> members,
+            const std::span<const FunctionRecord> functions,
+            const std::span<const ResolvedSid> sids
+        ) noexcept;
+
+        [[nodiscard]] b8 is_built() const noexcept {
+            return m_built;
+        }
+
+        [[nodiscard]] b8 is_mapped() const noexcept {
+            return m_mapping.is_open();
+        }
+
+        // the struct whose members start exactly at offset
+        [[nodiscard]] const StructRecord* at(const u32 offset) const noexcept;
+        // the struct that contains offset
+        [[nodiscard]] const StructRecord* find(const u32 offset) const noexcept;
+        // the lambda at offset
+        [[nodiscard]] const FunctionRecord* function_at(const u32 offset) const noexcept;
+        // the stored lookup result for sid, if the index has one
+        [[nodiscard]] const ResolvedSid* resolved_sid(const sid64 sid) const noexcept;
+
+        [[nodiscard]] std::span<const StructMember> members(const StructRecord& record) const noexcept {
+            return m_members.subspan(record.m_firstMember, record.m_numMembers);
+        }
+
+        [[nodiscard]] std::span<const StructRecord> structs() const noexcept {
+            return m_structs;
+        }
+
+        [[nodiscard]] std::span<const StructMember> all_members() const noexcept {
+            return m_members;
+        }
+
+        [[nodiscard]] std::span<const FunctionRecord> functions() const noexcept {
+            return m_functions;
+        }
+
+        [[nodiscard]] std::span<const ResolvedSid> resolved_sids() const noexcept {
+            return m_sids;
+        }
+
+        [[nodiscard]] u32 index_of(const StructRecord& record) const noexcept {
+            return &record - m_structs.data();
+        }
+
+        // remembers every sid that gets looked up, so the results can be stored in a sidecar
+        void record_sids(const b8 record) noexcept {
+            m_recordSids = record;
+        }
+
+        void record_sid(const sid64 sid) {
+            if (m_recordSids) {
+                m_usedSids.push_back(sid);
+            }
+        }
+
+        // sorted and deduplicated list of the recorded sids
+        [[nodiscard]] std::vector<sid64> used_sids() const;
+
+    private:
+        std::vector<StructRecord> m_ownedStructs;
+        std::vector<StructMember> m_ownedMembers;
+        std::vector<FunctionRecord> m_ownedFunctions;
+        std::vector<ResolvedSid> m_ownedSids;
+        std::span<const StructRecord> m_structs;
+        std::span<const StructMember> m_members;
+        std::span<const FunctionRecord> m_functions;
+        std::span<const ResolvedSid> m_sids;
+        MappedFile m_mapping;
+        std::unordered_map<u32, u32> m_pending;
+        std::vector<sid64> m_usedSids;
+        b8 m_built = false;
+        // whether the mapped tables were copied into the vectors
+        b8 m_detached = false;
+        b8 m_recordSids = false;
+
+        // copies mapped tables into the vectors before they get modified
+        void detach();
+        void update_views() noexcept;
+    };
+}
@@ -1,40 +1,110 @@
 #include "disassembly/file_disassembler.h"
+#include "disassembly/ndjson_disassembler.h"
 #include "disassembly/edit_disassembler.h"
+#include "disassembly/scan_disassembler.h"
+#include "disassembly/index_cache.h"
+#include "disassembly/dcpack.h"
+#include "disassembly/batch_reader.h"
+#include "disassembly/sidbase_builder.h"
 #include "cxxopts.hpp"
 #include "about.h"
 #include <chrono>
 #include <iostream>
 #include <filesystem>
 #include <execution>
+#include <fstream>
+#include <mutex>
+#include <thread>
 
 static constexpr char DEFAULT_OUT[] = "<input_path.txt>";
 
-static void disasm_file(
-    const std::filesystem::path &inpath, 
+static std::string listing_extension(const dconstruct::ListingFormat format, const dconstruct::OutputCompression compression) {
+    return std::string(format == dconstruct::ListingFormat::NDJSON ? ".ndjson" : ".txt") + dconstruct::compression_extension(compression);
+}
+
+// where the listing of a file ends up inside of an output folder
+static std::filesystem::path listing_path(std::filesystem::path path, const dconstruct::DisassemblerOptions &options) {
+    return path.concat(listing_extension(options.m_format, options.m_output.m_compression));
+}
+
+// the .dcir of a listing goes next to it, in place of the listing's extension
+static std::filesystem::path ir_path(const std::filesystem::path &listing, const dconstruct::DisassemblerOptions &options) {
+    std::string path = listing.string();
+    const std::string extension = listing_extension(options.m_format, options.m_output.m_compression);
+    if (path.ends_with(extension)) {
+        path.resize(path.size() - extension.size());
+    }
+    return path + ".dcir";
+}
+
+static void disasm_loaded_file(
+    dconstruct::BinaryFile &file,
     const std::filesystem::path &out_filename, 
     const dconstruct::SIDBase &base,
     const dconstruct::DisassemblerOptions &options,
-    const std::vector<std::string> &edits = {}) {
-    
-    dconstruct::BinaryFile file(inpath.string());
-    if (!file.dc_setup()) {
+    const dconstruct::DecodeMode decode_mode,
+    const b8 use_cache,
+    const u64 sidbase_id,
+    const std::vector<std::string> &edits) {
+
+    dconstruct::IndexCacheKey cache_key{};
+    if (use_cache) {
+        cache_key = { file.content_hash(), sidbase_id };
+    }
+    if (!file.dc_setup(decode_mode)) {
         return;
     }
 
+    const std::filesystem::path cache_path = dconstruct::index_cache_path(file.m_path);
+    const b8 cache_loaded = use_cache && dconstruct::load_index_cache(cache_path, cache_key, file.m_size, base, file.m_structIndex);
+    file.m_structIndex.record_sids(use_cache && !cache_loaded);
+
     if (!edits.empty()) {
         dconstruct::EditDisassembler ed(&file, &base, options, edits);
         ed.apply_file_edits();
     }
 
-    dconstruct::FileDisassembler disassembler(&file, &base, out_filename.string(), options);
-    disassembler.disassemble();
+    if (options.m_format == dconstruct::ListingFormat::NDJSON) {
+        dconstruct::NdjsonDisassembler disassembler(&file, &base, out_filename.string(), options);
+        disassembler.disassemble();
+    } else {
+        const std::string ir_file = options.m_writeIr ? ir_path(out_filename, options).string() : std::string{};
+        dconstruct::FileDisassembler disassembler(&file, &base, out_filename.string(), options, ir_file);
+        disassembler.disassemble();
+    }
+
+    // an edited index no longer describes the file on disk
+    if (use_cache && !cache_loaded && edits.empty()) {
+        if (!dconstruct::save_index_cache(cache_path, cache_key, file.m_structIndex, base)) {
+            std::cout << "warning: couldn't write index cache " << cache_path << '\n';
+        }
+    }
+}
+
+static void disasm_file(
+    const std::filesystem::path &inpath, 
+    const std::filesystem::path &out_filename, 
+    const dconstruct::SIDBase &base,
+    const dconstruct::DisassemblerOptions &options,
+    const dconstruct::LoadMode load_mode,
+    const dconstruct::DecodeMode decode_mode,
+    const b8 use_cache,
+    const u64 sidbase_id,
+    const std::vector<std::string> &edits = {}) {
+    
+    dconstruct::BinaryFile file(inpath.string(), load_mode);
+    disasm_loaded_file(file, out_filename, base, options, decode_mode, use_cache, sidbase_id, edits);
 }
 
 static void disassemble_multiple(
     const std::filesystem::path &in, 
     const std::filesystem::path &out, 
     const dconstruct::SIDBase &sidbase, 
-    const dconstruct::DisassemblerOptions &options) {
+    const dconstruct::DisassemblerOptions &options,
+    const dconstruct::LoadMode load_mode,
+    const dconstruct::DecodeMode decode_mode,
+    const b8 use_cache,
+    const u64 sidbase_id) {
 
     std::vector<std::filesystem::path> filepaths;
         
@@ -50,14 +120,94 @@ static void disassemble_multiple(
 
     std::cout << "disassembling " << filepaths.size() << " files into " << out << "...\n";
 
+    if (load_mode == dconstruct::LoadMode::READ) {
+        // the files are read ahead on a separate thread, and every worker takes whichever file finished loading next
+        dconstruct::BatchReader reader(filepaths);
+        const auto worker = [&]() {
+            dconstruct::LoadedFile loaded;
+            while (reader.next(loaded)) {
+                const std::filesystem::path &entry = filepaths[loaded.m_index];
+                if (!loaded.m_ok) {
+                    std::cout << "error: couldn't read " << entry << '\n';
+                    continue;
+                }
+                const std::filesystem::path outpath = listing_path(out / std::filesystem::relative(entry, in), options);
+                std::filesystem::create_directories(outpath.parent_path());
+                dconstruct::BinaryFile file(entry, std::move(loaded.m_bytes), loaded.m_size);
+                disasm_loaded_file(file, outpath, sidbase, options, decode_mode, use_cache, sidbase_id, {});
+            }
+        };
+        const u64 num_workers = std::clamp<u64>(std::thread::hardware_concurrency(), 1, std::max<u64>(filepaths.size(), 1));
+        std::vector<std::thread> workers;
+        workers.reserve(num_workers);
+        for (u64 i = 0; i < num_workers; ++i) {
+            workers.emplace_back(worker);
+        }
+        for (std::thread &thread : workers) {
+            thread.join();
+        }
+    } else {
+        std::for_each(
+            std::execution::par_unseq,
+            filepaths.begin(),
+            filepaths.end(),
+            [&](const std::filesystem::path &entry) {
+                const std::filesystem::path outpath = listing_path(out / std::filesystem::relative(entry, in), options);
+                std::filesystem::create_directories(outpath.parent_path());
+                disasm_file(entry.string(), outpath, sidbase, options, load_mode, decode_mode, use_cache, sidbase_id);
+            }
+        );
+    }
+
+    const auto time_taken = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+
+
+    std::cout << "took " << time_taken.count() << "ms\n";
+}
+
+static void disassemble_pack(
+    const std::filesystem::path &in, 
+    const std::filesystem::path &out, 
+    const dconstruct::SIDBase &sidbase, 
+    const dconstruct::DisassemblerOptions &options,
+    const dconstruct::LoadMode load_mode,
+    const dconstruct::DecodeMode decode_mode) {
+
+    // with a copy-on-write mapping, entries are relocated in place and only the pages holding pointers get copied.
+    // those copies are given back after each entry, so memory stays bounded by the number of workers. where that
+    // isn't possible, or the mapping can't be made, every entry is copied out of a read-only mapping instead.
+    dconstruct::DcPack pack;
+    dconstruct::LoadMode entry_mode = load_mode;
+    if (load_mode == dconstruct::LoadMode::MAPPED && !dconstruct::MappedFile::can_discard()) {
+        entry_mode = dconstruct::LoadMode::READ;
+    }
+    if (!pack.open(in, entry_mode == dconstruct::LoadMode::MAPPED ? dconstruct::MapAccess::COPY_ON_WRITE : dconstruct::MapAccess::READ_ONLY)) {
+        if (entry_mode != dconstruct::LoadMode::MAPPED || !pack.open(in, dconstruct::MapAccess::READ_ONLY)) {
+            std::cout << "error: " << in << " is not a valid dcpack\n";
+            return;
+        }
+        entry_mode = dconstruct::LoadMode::READ;
+    }
+
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    std::cout << "disassembling " << pack.entries().size() << " files from " << in << " into " << out << "...\n";
+
     std::for_each(
         std::execution::par_unseq,
-        filepaths.begin(),
-        filepaths.end(),
-        [&](const std::filesystem::path &entry) {
-            const std::filesystem::path outpath = (out / std::filesystem::relative(entry, in)).concat(".txt");
+        pack.entries().begin(),
+        pack.entries().end(),
+        [&](const dconstruct::DcPackEntry &entry) {
+            const std::filesystem::path relative_path = pack.path(entry);
+            const std::filesystem::path outpath = listing_path(out / relative_path, options);
             std::filesystem::create_directories(outpath.parent_path());
-            disasm_file(entry.string(), outpath, sidbase, options);
+            {
+                dconstruct::BinaryFile file(in / relative_path, pack.data(entry), entry.m_size, entry_mode);
+                disasm_loaded_file(file, outpath, sidbase, options, decode_mode, false, 0, {});
+            }
+            if (entry_mode == dconstruct::LoadMode::MAPPED) {
+                pack.release(entry);
+            }
         }
     );
 
@@ -67,6 +217,197 @@ static void disassemble_multiple(
     std::cout << "took " << time_taken.count() << "ms\n";
 }
 
+static i32 pack_main(int argc, char *argv[]) {
+    cxxopts::Options options("dconstruct pack", "\npacks every .bin file inside of a folder into a single .dcpack file. the pack can then be used as the input for disassembling the whole folder.\n");
+
+    options.add_options()
+        ("h, help", "display this message")
+        ("i,input", "input folder", cxxopts::value<std::string>(), "<path>")
+        ("o,output", "output file", cxxopts::value<std::string>(), "<path>");
+
+    options.parse_positional({"i", "o"});
+    auto opts = options.parse(argc, argv);
+
+    if (opts.count("h") > 0 || opts.count("i") == 0 || opts.count("o") == 0) {
+        std::cout << options.help() << '\n';
+        return -1;
+    }
+
+    const std::filesystem::path input = opts["i"].as<std::string>();
+    if (!std::filesystem::is_directory(input)) {
+        std::cout << "error: input path " << input << " isn't a folder\n";
+        return -1;
+    }
+    const std::filesystem::path output = opts["o"].as<std::string>();
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    const i64 num_files = dconstruct::write_dcpack(input, output);
+    if (num_files < 0) {
+        return -1;
+    }
+    const auto time_taken = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+    std::cout << "packed " << num_files << " files into " << output << " in " << time_taken.count() << "ms\n";
+    return 0;
+}
+
+static i32 build_sidbase_mph(const std::filesystem::path &sidbase_path) {
+    if (!std::filesystem::exists(sidbase_path)) {
+        std::cout << "error: sidbase path " << sidbase_path << " doesn't exist\n";
+        return -1;
+    }
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    dconstruct::SIDBaseLayer base{};
+    base.load(sidbase_path, false);
+    if (!base.is_sorted_on_disk()) {
+        std::cout << "error: the perfect hash can only be built for a sorted sidbase\n";
+        return -1;
+    }
+    const std::filesystem::path mph_path = dconstruct::sid_mph_path(sidbase_path);
+    if (!dconstruct::write_sid_mph(mph_path, base.entries(), base.fingerprint())) {
+        return -1;
+    }
+    const auto time_taken = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+    std::cout << "wrote perfect hash over " << base.entries().size() << " sids to " << mph_path << " in " << time_taken.count() << "ms\n";
+    return 0;
+}
+
+static i32 build_sidbase(const std::vector<std::string> &input_strings, const std::filesystem::path &output, const b8 compress) {
+    std::vector<std::filesystem::path> inputs;
+    for (const std::string &input : input_strings) {
+        if (!std::filesystem::is_regular_file(input)) {
+            std::cout << "error: input path " << input << " isn't a file\n";
+            return -1;
+        }
+        inputs.emplace_back(input);
+    }
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    dconstruct::SidbaseBuildStats stats;
+    if (!dconstruct::build_sidbase(inputs, output, compress, stats)) {
+        return -1;
+    }
+    const auto time_taken = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+    std::cout << "wrote " << stats.m_numEntries << " sids to " << output << " in " << time_taken.count() << "ms (" 
+        << stats.m_numInputs << " strings read, " << stats.m_numDuplicates << " duplicates, " << stats.m_numCollisions << " collisions)\n";
+    return 0;
+}
+
+static void scan_loaded_file(dconstruct::BinaryFile &file, const dconstruct::SIDBase &base, std::vector<sid64> &used_sids, std::mutex &used_sids_mutex) {
+    if (!file.dc_setup(dconstruct::DecodeMode::OFFSETS)) {
+        return;
+    }
+    file.m_structIndex.record_sids(true);
+    dconstruct::ScanDisassembler disassembler(&file, &base, dconstruct::DisassemblerOptions{});
+    disassembler.disassemble();
+
+    const std::vector<sid64> file_sids = file.m_structIndex.used_sids();
+    std::lock_guard lock(used_sids_mutex);
+    used_sids.insert(used_sids.end(), file_sids.begin(), file_sids.end());
+}
+
+// disassembles every file in a folder or dcpack without writing anything, and returns every sid that got looked up
+static std::vector<sid64> scan_used_sids(const std::filesystem::path &in, const dconstruct::SIDBase &base) {
+    std::vector<sid64> used_sids;
+    std::mutex used_sids_mutex;
+
+    if (std::filesystem::is_directory(in)) {
+        std::vector<std::filesystem::path> filepaths;
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(in)) {
+            if (entry.path().extension() == ".bin") {
+                filepaths.emplace_back(entry.path());
+            }
+        }
+        std::cout << "scanning " << filepaths.size() << " files...\n";
+        std::for_each(
+            std::execution::par_unseq,
+            filepaths.begin(),
+            filepaths.end(),
+            [&](const std::filesystem::path &entry) {
+                dconstruct::BinaryFile file(entry.string(), dconstruct::LoadMode::MAPPED_READ_ONLY);
+                scan_loaded_file(file, base, used_sids, used_sids_mutex);
+            }
+        );
+    } else {
+        dconstruct::DcPack pack;
+        if (!pack.open(in, dconstruct::MapAccess::READ_ONLY)) {
+            std::cout << "error: " << in << " is neither a folder nor a valid dcpack\n";
+            return used_sids;
+        }
+        std::cout << "scanning " << pack.entries().size() << " files from " << in << "...\n";
+        std::for_each(
+            std::execution::par_unseq,
+            pack.entries().begin(),
+            pack.entries().end(),
+            [&](const dconstruct::DcPackEntry &entry) {
+                dconstruct::BinaryFile file(in / pack.path(entry), pack.data(entry), entry.m_size, dconstruct::LoadMode::MAPPED_READ_ONLY);
+                scan_loaded_file(file, base, used_sids, used_sids_mutex);
+            }
+        );
+    }
+    return used_sids;
+}
+
+static i32 build_sidbase_subset(const std::filesystem::path &corpus, const std::vector<std::string> &sidbase_paths, const std::filesystem::path &output, const b8 compress) {
+    if (!std::filesystem::exists(corpus)) {
+        std::cout << "error: corpus path " << corpus << " doesn't exist\n";
+        return -1;
+    }
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    dconstruct::SIDBase base{};
+    for (const std::string &sidbase_path : sidbase_paths) {
+        base.add_layer(sidbase_path);
+    }
+    base.build_search_index();
+
+    const std::vector<sid64> used_sids = scan_used_sids(corpus, base);
+    u64 num_entries = 0;
+    if (!dconstruct::write_sidbase_subset(base, used_sids, output, compress, num_entries)) {
+        return -1;
+    }
+    const auto time_taken = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+    std::cout << "wrote " << num_entries << " sids (" << std::filesystem::file_size(output) / 1024 << " KB) used by " << corpus << " to " << output
+        << " in " << time_taken.count() << "ms\n";
+    return 0;
+}
+
+static i32 sidbase_main(int argc, char *argv[]) {
+    cxxopts::Options options("dconstruct sidbase", "\ntools for preparing a sidbase.\n\n"
+        "  build <inputs...> [-o <path>] [--compress]\n"
+        "                                   build a sorted sidbase out of sidbases in any order and/or text files with one string per line.\n"
+        "  mph [<sidbase>]                  build a perfect hash over the sidbase and write it to <sidbase>.mph. later runs map it and resolve every hash with a single lookup.\n"
+        "  subset <corpus> -o <path> [-s <sidbase>...] [--compress]\n"
+        "                                   build a sidbase with only the sids that the files in a folder or dcpack look up. it disassembles them the same as the full sidbase.\n");
+
+    options.add_options()
+        ("h, help", "display this message")
+        ("command", "build, mph or subset", cxxopts::value<std::string>(), "<command>")
+        ("inputs", "input files", cxxopts::value<std::vector<std::string>>(), "<path>")
+        ("o,output", "output file for build and subset", cxxopts::value<std::string>()->default_value("sidbase.bin"), "<path>")
+        ("s,sidbase", "sidbase to take the subset of, with overlays the same as for disassembling", cxxopts::value<std::vector<std::string>>()->default_value("sidbase.bin"), "<path>")
+        ("compress", "front code the strings of the built sidbase. it's a lot smaller, and only the strings that are looked up get decoded.",
+            cxxopts::value<b8>()->default_value("false"));
+
+    options.parse_positional({"command", "inputs"});
+    auto opts = options.parse(argc, argv);
+
+    const std::string command = opts.count("command") > 0 ? opts["command"].as<std::string>() : "";
+    const std::vector<std::string> inputs = opts.count("inputs") > 0 ? opts["inputs"].as<std::vector<std::string>>() : std::vector<std::string>{};
+
+    if (opts.count("h") == 0 && command == "mph" && inputs.size() <= 1) {
+        return build_sidbase_mph(inputs.empty() ? "sidbase.bin" : inputs[0]);
+    }
+    if (opts.count("h") == 0 && command == "build" && !inputs.empty()) {
+        return build_sidbase(inputs, opts["o"].as<std::string>(), opts["compress"].as<b8>());
+    }
+    if (opts.count("h") == 0 && command == "subset" && inputs.size() == 1 && opts.count("o") > 0) {
+        return build_sidbase_subset(inputs[0], opts["s"].as<std::vector<std::string>>(), opts["o"].as<std::string>(), opts["compress"].as<b8>());
+    }
+    std::cout << options.help() << '\n';
+    return -1;
+}
+
 static std::vector<std::string> edits_from_file(const std::filesystem::path &path) {
     std::ifstream edit_in(path);
     std::vector<std::string> result;
@@ -84,6 +425,13 @@ static std::vector<std::string> edits_from_file(const std::filesystem::path &pat
 
 int main(int argc, char *argv[]) {
 
+    if (argc > 1 && std::string_view(argv[1]) == "pack") {
+        return pack_main(argc - 1, argv + 1);
+    }
+    if (argc > 1 && std::string_view(argv[1]) == "sidbase") {
+        return sidbase_main(argc - 1, argv + 1);
+    }
+
     cxxopts::Options options("dconstruct", "\na program for disassembling and editing tlouii dc files. use --about for a more detailed description.\n");
 
     options.add_options("information")
@@ -93,10 +441,26 @@ int main(int argc, char *argv[]) {
     options.add_options("input/output")
         ("i,input",  "input DC file or folder", cxxopts::value<std::string>(), "<path>")
         ("o,output", "output file or folder", cxxopts::value<std::string>()->default_value(""), DEFAULT_OUT)
-        ("s,sidbase", "sidbase file", cxxopts::value<std::string>()->default_value("sidbase.bin"), "<path>");
+        ("s,sidbase", "sidbase file. every further -s adds an overlay on top, which can also be a text file with one string per line. "
+            "overlays are searched before the layers below them.", cxxopts::value<std::vector<std::string>>()->default_value("sidbase.bin"), "<path>");
     options.add_options("configuration")
         ("indent", "number of spaces per indentation level in the output file", cxxopts::value<u8>()->default_value("2"), "n")
         ("emit_once", "only emit the first occurence of a struct. repeating instances will still show the address but not the contents of the struct.", 
+            cxxopts::value<b8>()->default_value("false"))
+        ("no_mmap", "read input files into memory instead of memory-mapping them.", cxxopts::value<b8>()->default_value("false"))
+        ("no_reloc", "don't relocate the input file. pointers are resolved as file offsets instead, so the file stays unmodified and can be mapped read-only.",
+            cxxopts::value<b8>()->default_value("false"))
+        ("cache", "store the analysis of every input file in a <file>.dcidx next to it and reuse it while neither the file nor the sidbase change.",
+            cxxopts::value<b8>()->default_value("false"))
+        ("shm", "share the sidbase search index with other dconstruct processes through shared memory. the first run publishes it, "
+            "later runs with the same sidbase map it instead of building their own.", cxxopts::value<b8>()->default_value("false"))
+        ("compress", "compress the output files while they're written, as <file>.txt.zst or <file>.txt.gz.", cxxopts::value<std::string>(), "zstd|gzip")
+        ("level", "compression level for --compress. the default is 3 for zstd and 6 for gzip.", cxxopts::value<i32>()->default_value("0"), "n")
+        ("compress_threads", "extra threads that compress each output file with zstd. files are already disassembled in parallel, so this mostly helps with single large files.",
+            cxxopts::value<u32>()->default_value("0"), "n")
+        ("ndjson", "write the listing as newline delimited json instead of text, one object per entry, struct, member and function, into <file>.ndjson.",
+            cxxopts::value<b8>()->default_value("false"))
+        ("ir", "also write the structs, members, functions and sids of every listing into a <file>.dcir next to it, as tables that can be memory-mapped.",
             cxxopts::value<b8>()->default_value("false"));
     options.add_options("edit")
         ("e,edit", "make an edit at a specific address. may only be specified during single file disassembly.", cxxopts::value<std::vector<std::string>>(), "<addr>[<offset>]=<new_value>")
@@ -134,16 +498,49 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    const b8 input_is_pack = !std::filesystem::is_directory(filepath) && dconstruct::is_dcpack(filepath);
+
     std::vector<std::string> edits{};
     if (opts.count("edit_file") > 0) {
         std::string test = opts["edit_file"].as<std::string>();
         edits = edits_from_file(test);
     }
 
+    dconstruct::OutputOptions output_options{};
+    if (opts.count("compress") > 0) {
+        const std::string compression = opts["compress"].as<std::string>();
+        if (compression == "zstd") {
+            output_options.m_compression = dconstruct::OutputCompression::ZSTD;
+        } else if (compression == "gzip") {
+            output_options.m_compression = dconstruct::OutputCompression::GZIP;
+        } else {
+            std::cout << "error: unknown compression '" << compression << "', use zstd or gzip\n";
+            return -1;
+        }
+        if (!dconstruct::is_compression_supported(output_options.m_compression)) {
+            std::cout << "error: this build of dconstruct can't write " << compression << " files\n";
+            return -1;
+        }
+        output_options.m_level = opts["level"].as<i32>();
+        output_options.m_threads = opts["compress_threads"].as<u32>();
+        if (output_options.m_compression == dconstruct::OutputCompression::GZIP && output_options.m_threads > 0) {
+            std::cout << "warning: --compress_threads is ignored for gzip.\n";
+            output_options.m_threads = 0;
+        }
+    }
+    const dconstruct::ListingFormat listing_format = opts["ndjson"].as<b8>() ? dconstruct::ListingFormat::NDJSON : dconstruct::ListingFormat::TEXT;
+    b8 write_ir = opts["ir"].as<b8>();
+    if (write_ir && listing_format == dconstruct::ListingFormat::NDJSON) {
+        std::cout << "warning: --ir is ignored, it's written together with the text listing.\n";
+        write_ir = false;
+    }
+    // the extension of generated output names. an output file that's given explicitly is used as it is.
+    const std::string output_extension = listing_extension(listing_format, output_options.m_compression);
+
     std::filesystem::path output;
     if (opts.count("o") == 0) {
-        if (!std::filesystem::is_directory(filepath)) {
-            output = filepath.string() + ".txt";
+        if (!std::filesystem::is_directory(filepath) && !input_is_pack) {
+            output = filepath.string() + output_extension;
         } else {
             constexpr char default_out_folder_path[] = "./disassembled";
             std::filesystem::create_directory(default_out_folder_path);
@@ -155,34 +552,71 @@ int main(int argc, char *argv[]) {
             std::cout << "error: output filepath " << output << " doesn't exist\n";
             return -1;
         }
-        if (std::filesystem::is_directory(output) && !std::filesystem::is_directory(filepath)) {
-            output /= filepath.filename().string() + ".txt";
+        if (std::filesystem::is_directory(output) && !std::filesystem::is_directory(filepath) && !input_is_pack) {
+            output /= filepath.filename().string() + output_extension;
         }
     }
 
     const b8 output_is_folder = std::filesystem::is_directory(output);
 
-    const std::filesystem::path sidbase_path = opts["s"].as<std::string>();
-    if (!std::filesystem::exists(sidbase_path)) {
-        std::cout << "error: sidbase path " << sidbase_path << " doesn't exist\n";
-        return -1;
+    const std::vector<std::string> sidbase_paths = opts["s"].as<std::vector<std::string>>();
+    for (const std::string& sidbase_path : sidbase_paths) {
+        if (!std::filesystem::exists(sidbase_path)) {
+            std::cout << "error: sidbase path " << std::filesystem::path(sidbase_path) << " doesn't exist\n";
+            return -1;
+        }
     }
 
     const u8 indent_per_level = opts["indent"].as<u8>();
     const b8 emit_once = opts["emit_once"].as<b8>();
+    const dconstruct::DecodeMode decode_mode = opts["no_reloc"].as<b8>() ? dconstruct::DecodeMode::OFFSETS : dconstruct::DecodeMode::RELOCATED;
     if (opts.count("e") > 0) {
         std::vector<std::string> edit_strings = opts["e"].as<std::vector<std::string>>();
         edits.insert(edits.end(), edit_strings.begin(), edit_strings.end());
     }
+    dconstruct::LoadMode load_mode = dconstruct::LoadMode::MAPPED;
+    if (opts["no_mmap"].as<b8>()) {
+        load_mode = dconstruct::LoadMode::READ;
+    } else if (decode_mode == dconstruct::DecodeMode::OFFSETS && (edits.empty() || std::filesystem::is_directory(filepath))) {
+        load_mode = dconstruct::LoadMode::MAPPED_READ_ONLY;
+    }
     const dconstruct::DisassemblerOptions disassember_options {
         indent_per_level,
         emit_once,
+        output_options,
+        listing_format,
+        write_ir,
     };
 
     dconstruct::SIDBase base{};
-    base.load(sidbase_path);
+    for (const std::string& sidbase_path : sidbase_paths) {
+        base.add_layer(sidbase_path);
+    }
 
-    if (std::filesystem::is_directory(filepath)) {
+    const b8 use_cache = opts["cache"].as<b8>();
+    const u64 sidbase_id = use_cache ? base.identity() : 0;
+
+    b8 use_shm = opts["shm"].as<b8>();
+    if (use_shm && !dconstruct::SidSharedSegment::is_supported()) {
+        std::cout << "warning: --shm is ignored, shared memory isn't supported on this platform.\n";
+        use_shm = false;
+    }
+
+    if (input_is_pack) {
+        if (!output_is_folder) {
+            std::cout << "error: the input " << filepath << " is a dcpack, but output " << output << " is a file.\n";
+            return -1;
+        }
+        if (!edits.empty()) {
+            std::cout << "warning: edits ignored as input path is a dcpack. edits only work in single file disassembly.\n";
+        }
+        if (use_cache) {
+            std::cout << "warning: --cache is ignored for dcpack inputs.\n";
+        }
+        // a whole corpus does enough lookups to pay for the faster search layout
+        base.build_search_index(use_shm);
+        disassemble_pack(filepath, output, base, disassember_options, load_mode, decode_mode);
+    } else if (std::filesystem::is_directory(filepath)) {
         if (!output_is_folder) {
             std::cout << "error: the input " << filepath << " is a folder, but output " << output << " is a file.\n";
             return -1;
@@ -190,11 +624,15 @@ int main(int argc, char *argv[]) {
         if (!edits.empty()) {
             std::cout << "warning: edits ignored as input path is a directory. edits only work in single file disassembly.\n";
         }
-        disassemble_multiple(filepath, output, base, disassember_options);
+        base.build_search_index(use_shm);
+        disassemble_multiple(filepath, output, base, disassember_options, load_mode, decode_mode, use_cache, sidbase_id);
     } else {
         std::cout << "disassembling " << filepath.filename() << " to " << output << "...\n";
+        if (use_shm) {
+            base.build_search_index(true);
+        }
         const auto start = std::chrono::high_resolution_clock::now();
-        disasm_file(filepath, output, base, disassember_options, edits);
+        disasm_file(filepath, output, base, disassember_options, load_mode, decode_mode, use_cache, sidbase_id, edits);
         const auto time_taken = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
         std::cout << "took " << time_taken.count() << "ms\n";
     }